@@ -17,6 +17,7 @@
 #include <drivers/auth/auth_mod.h>
 #include <drivers/auth/crypto_mod.h>
 #include <drivers/console.h>
+#include <drivers/io/io_storage.h>
 #include <lib/bootmarker_capture.h>
 #include <lib/cpus/errata.h>
 #include <lib/pmf/pmf.h>
@@ -162,6 +163,9 @@ void bl1_main(void)
 	else
 		NOTICE("BL1-FWU: *******FWU Process Started*******\n");
 
+	/* Close the IO devices kept open while loading BL2 */
+	(void)io_dev_close_all();
+
 	/* Teardown the measured boot driver */
 	bl1_plat_mboot_finish();
 
@@ -16,6 +16,7 @@
 #include <drivers/auth/crypto_mod.h>
 #include <drivers/console.h>
 #include <drivers/fwu/fwu.h>
+#include <drivers/io/io_storage.h>
 #include <lib/bootmarker_capture.h>
 #include <lib/extensions/pauth.h>
 #include <lib/pmf/pmf.h>
@@ -116,6 +117,9 @@ void bl2_main(void)
 	/* Load the subsequent bootloader images. */
 	next_bl_ep_info = bl2_load_images();
 
+	/* Close the IO devices kept open while loading the images */
+	(void)io_dev_close_all();
+
 	/* Teardown the Measured Boot backend */
 	bl2_plat_mboot_finish();
 
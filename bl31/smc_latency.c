@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2024, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <arch_helpers.h>
+#include <bl31/smc_latency.h>
+#include <lib/el3_runtime/cpu_data.h>
+#include <lib/pmf/pmf.h>
+#include <lib/utils_def.h>
+#include <plat/common/platform.h>
+
+#include <platform_def.h>
+
+CASSERT(IS_POWER_OF_TWO(SMC_LATENCY_MAX_FIDS),
+	assert_smc_latency_max_fids_power_of_two);
+
+/* Latency statistics of one SMC function ID */
+typedef struct smc_latency_entry {
+	uint32_t smc_fid;
+	uint64_t calls;
+	uint64_t ticks;
+	uint64_t buckets[SMC_LATENCY_BUCKETS];
+} smc_latency_entry_t;
+
+/*
+ * Statistics of the SMCs handled by one CPU. Only the owning CPU updates
+ * them, so no locking is needed. An entry with no calls is free.
+ */
+typedef struct smc_latency_cpu {
+	smc_latency_entry_t entries[SMC_LATENCY_MAX_FIDS];
+	uint64_t dropped;
+} __aligned(CACHE_WRITEBACK_GRANULE) smc_latency_cpu_t;
+
+static smc_latency_cpu_t smc_latency_stats[PLATFORM_CORE_COUNT];
+
+static unsigned int smc_latency_hash(uint32_t smc_fid)
+{
+	/* Mix the OEN and call type into the function number */
+	return (smc_fid ^ (smc_fid >> FUNCID_OEN_SHIFT)) &
+		(SMC_LATENCY_MAX_FIDS - 1U);
+}
+
+/*
+ * Find the entry of 'smc_fid' in the table of a CPU. When 'add' is true and
+ * the function ID has no entry yet, a free one is returned instead. Returns
+ * NULL if the function ID is not found and no entry can be used.
+ */
+static smc_latency_entry_t *smc_latency_find(smc_latency_cpu_t *stats,
+					     uint32_t smc_fid, bool add)
+{
+	unsigned int slot = smc_latency_hash(smc_fid);
+	unsigned int i;
+
+	for (i = 0U; i < SMC_LATENCY_MAX_FIDS; i++) {
+		smc_latency_entry_t *entry = &stats->entries[slot];
+
+		if (entry->calls == 0U) {
+			if (!add) {
+				return NULL;
+			}
+			entry->smc_fid = smc_fid;
+			return entry;
+		}
+
+		if (entry->smc_fid == smc_fid) {
+			return entry;
+		}
+
+		slot = (slot + 1U) & (SMC_LATENCY_MAX_FIDS - 1U);
+	}
+
+	return NULL;
+}
+
+/*
+ * Called from the SMC exception handler once the runtime service has
+ * returned, just before el3_exit(). The time of entry into EL3 was saved in
+ * the per-cpu data by the exception vector.
+ */
+void smc_latency_record(uint32_t smc_fid)
+{
+	smc_latency_cpu_t *stats = &smc_latency_stats[plat_my_core_pos()];
+	smc_latency_entry_t *entry;
+	uint64_t ticks;
+	unsigned int bucket;
+
+	ticks = read_cntpct_el0() -
+		get_cpu_data(cpu_data_pmf_ts[CPU_DATA_PMF_TS0_IDX]);
+
+	entry = smc_latency_find(stats, smc_fid, true);
+	if (entry == NULL) {
+		stats->dropped++;
+		return;
+	}
+
+	/* floor(log2(ticks)), clamped to the last bucket */
+	bucket = 0U;
+	if (ticks != 0U) {
+		bucket = 63U - (unsigned int)__builtin_clzll(ticks);
+	}
+	if (bucket >= SMC_LATENCY_BUCKETS) {
+		bucket = SMC_LATENCY_BUCKETS - 1U;
+	}
+
+	entry->calls++;
+	entry->ticks += ticks;
+	entry->buckets[bucket]++;
+}
+
+static uint64_t smc_latency_value(const smc_latency_entry_t *entry,
+				  unsigned int local_id)
+{
+	if (local_id == SMC_LATENCY_CALLS) {
+		return entry->calls;
+	}
+
+	if (local_id == SMC_LATENCY_TICKS) {
+		return entry->ticks;
+	}
+
+	return entry->buckets[local_id];
+}
+
+/*
+ * PMF handler returning one of the statistics of a CPU. The local timestamp
+ * ID selects the statistic and 'flags' holds the SMC function ID it is
+ * requested for, with SMC_LATENCY_BY_OEN optionally set.
+ */
+static unsigned long long smc_latency_get(unsigned int tid, u_register_t mpidr,
+					  unsigned int flags)
+{
+	unsigned int local_id = tid & PMF_TID_MASK;
+	uint32_t smc_fid = flags & ~SMC_LATENCY_BY_OEN;
+	smc_latency_cpu_t *stats;
+	const smc_latency_entry_t *entry;
+	unsigned long long value = 0ULL;
+	int cpu_pos;
+	unsigned int i;
+
+	cpu_pos = plat_core_pos_by_mpidr(mpidr);
+	if (cpu_pos < 0) {
+		return 0ULL;
+	}
+
+	assert(local_id < SMC_LATENCY_TOTAL_IDS);
+	stats = &smc_latency_stats[cpu_pos];
+
+	if (local_id == SMC_LATENCY_DROPPED) {
+		return stats->dropped;
+	}
+
+	if ((flags & SMC_LATENCY_BY_OEN) == 0U) {
+		entry = smc_latency_find(stats, smc_fid, false);
+		return (entry == NULL) ? 0ULL :
+			smc_latency_value(entry, local_id);
+	}
+
+	for (i = 0U; i < SMC_LATENCY_MAX_FIDS; i++) {
+		entry = &stats->entries[i];
+
+		if ((entry->calls != 0U) &&
+		    (GET_SMC_TYPE(entry->smc_fid) == GET_SMC_TYPE(smc_fid)) &&
+		    (GET_SMC_OEN(entry->smc_fid) == GET_SMC_OEN(smc_fid))) {
+			value += smc_latency_value(entry, local_id);
+		}
+	}
+
+	return value;
+}
+
+PMF_REGISTER_SERVICE_SMC_OWN(smc_latency, PMF_ARM_TIF_IMPL_ID,
+			     PMF_SMC_LATENCY_SVC_ID, SMC_LATENCY_TOTAL_IDS,
+			     NULL, smc_latency_get)
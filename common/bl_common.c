@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2022, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2013-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -14,11 +14,20 @@
 #include <common/bl_common.h>
 #include <common/debug.h>
 #include <drivers/auth/auth_mod.h>
+#include <drivers/auth/crypto_mod.h>
 #include <drivers/io/io_storage.h>
 #include <lib/utils.h>
 #include <lib/xlat_tables/xlat_tables_defs.h>
 #include <plat/common/platform.h>
 
+/*
+ * Size of the chunks in which an image is read when it is hashed while being
+ * loaded.
+ */
+#ifndef LOAD_IMAGE_CHUNK_SIZE
+#define LOAD_IMAGE_CHUNK_SIZE	U(0x10000)
+#endif
+
 #if TRUSTED_BOARD_BOOT
 # ifdef DYN_DISABLE_AUTH
 static int disable_auth;
@@ -59,15 +68,118 @@ uintptr_t page_align(uintptr_t value, unsigned dir)
 	return value;
 }
 
+/* Ways in which load_image() can read an image */
+typedef enum {
+	/* In a single read at the image base address */
+	LOAD_IMAGE_WHOLE,
+	/* In chunks at the image base address, hashed as they are read */
+	LOAD_IMAGE_HASHED,
+	/* In chunks into the staging buffers of the registered pipeline */
+	LOAD_IMAGE_PIPELINED,
+} load_image_mode_t;
+
+/* Pipeline registered with load_image_set_pipeline() and its target image */
+static const image_load_pipeline_t *load_pipeline;
+static const image_info_t *load_pipeline_image;
+
+/*******************************************************************************
+ * Have the next load of the image described by 'image_data' go through
+ * 'pipeline' rather than to the image base address. The pipeline is only used
+ * if the image does not have to be in memory once loaded, i.e. if it is not
+ * authenticated or measured. It applies to one call to load_auth_image().
+ ******************************************************************************/
+void load_image_set_pipeline(const image_info_t *image_data,
+			     const image_load_pipeline_t *pipeline)
+{
+	assert((pipeline == NULL) ||
+	       ((pipeline->chunk_size != 0U) && (pipeline->start != NULL) &&
+		(pipeline->process != NULL)));
+
+	load_pipeline_image = image_data;
+	load_pipeline = pipeline;
+}
+
+/*******************************************************************************
+ * Internal function to read an image in chunks, processing each chunk as soon
+ * as it has been read, while the data is still in the cache, rather than in a
+ * second pass over the whole image:
+ *  - LOAD_IMAGE_HASHED: the image is read at its base address and each chunk
+ *    is passed to the authentication module.
+ *  - LOAD_IMAGE_PIPELINED: the chunks are read alternately into the two
+ *    staging buffers of the pipeline and passed to its 'process' handler, so
+ *    that the previous chunk is left intact while the next one is read.
+ ******************************************************************************/
+static int read_image_chunks(uintptr_t image_handle, uintptr_t image_base,
+			     size_t image_size, load_image_mode_t mode,
+			     size_t *bytes_read)
+{
+	size_t offset = 0U;
+	size_t max_chunk_size = LOAD_IMAGE_CHUNK_SIZE;
+	size_t chunk_size, chunk_read;
+	uintptr_t chunk_base;
+	unsigned int staging_idx = 0U;
+	int io_result = 0;
+
+	if (mode == LOAD_IMAGE_PIPELINED) {
+		max_chunk_size = load_pipeline->chunk_size;
+		io_result = load_pipeline->start();
+		if (io_result != 0) {
+			*bytes_read = 0U;
+			return io_result;
+		}
+	}
+
+	while (offset < image_size) {
+		chunk_size = MIN(image_size - offset, max_chunk_size);
+
+		if (mode == LOAD_IMAGE_PIPELINED) {
+			chunk_base = load_pipeline->buf_base +
+				     (staging_idx * max_chunk_size);
+			staging_idx ^= 1U;
+		} else {
+			chunk_base = image_base + offset;
+		}
+
+		io_result = io_read(image_handle, chunk_base, chunk_size,
+				    &chunk_read);
+		if ((io_result != 0) || (chunk_read == 0U)) {
+			break;
+		}
+
+#if TRUSTED_BOARD_BOOT
+		if (mode == LOAD_IMAGE_HASHED) {
+			auth_mod_hash_img_update((void *)chunk_base,
+						 (unsigned int)chunk_read);
+		}
+#endif
+		if (mode == LOAD_IMAGE_PIPELINED) {
+			io_result = load_pipeline->process(chunk_base,
+							   chunk_read);
+			if (io_result != 0) {
+				break;
+			}
+		}
+
+		offset += chunk_read;
+	}
+
+	*bytes_read = offset;
+
+	return io_result;
+}
+
 /*******************************************************************************
  * Internal function to load an image at a specific address given
  * an image ID and extents of free memory.
  *
+ * 'mode' selects how the image is read, see load_image_mode_t.
+ *
  * If the load is successful then the image information is updated.
  *
  * Returns 0 on success, a negative error code otherwise.
  ******************************************************************************/
-static int load_image(unsigned int image_id, image_info_t *image_data)
+static int load_image(unsigned int image_id, image_info_t *image_data,
+		      load_image_mode_t mode)
 {
 	uintptr_t dev_handle;
 	uintptr_t image_handle;
@@ -123,7 +235,13 @@ static int load_image(unsigned int image_id, image_info_t *image_data)
 
 	/* We have enough space so load the image now */
 	/* TODO: Consider whether to try to recover/retry a partially successful read */
-	io_result = io_read(image_handle, image_base, image_size, &bytes_read);
+	if (mode == LOAD_IMAGE_WHOLE) {
+		io_result = io_read(image_handle, image_base, image_size,
+				    &bytes_read);
+	} else {
+		io_result = read_image_chunks(image_handle, image_base,
+					      image_size, mode, &bytes_read);
+	}
 	if ((io_result != 0) || (bytes_read < image_size)) {
 		WARN("Failed to load image id=%u (%i)\n", image_id, io_result);
 		goto exit;
@@ -136,7 +254,10 @@ exit:
 	(void)io_close(image_handle);
 	/* Ignore improbable/unrecoverable error in 'close' */
 
-	/* TODO: Consider maintaining open device connection from this bootloader stage */
+	/*
+	 * With PERSISTENT_IO_DEVICES, this only drops a reference and the
+	 * device is kept open until the end of the bootloader stage.
+	 */
 	(void)io_dev_close(dev_handle);
 	/* Ignore improbable/unrecoverable error in 'dev_close' */
 
@@ -164,8 +285,13 @@ static int load_auth_image_recursive(unsigned int image_id,
 		}
 	}
 
-	/* Load the image */
-	rc = load_image(image_id, image_data);
+	/*
+	 * Load the image, hashing it as it is read if its authentication
+	 * method allows it.
+	 */
+	rc = load_image(image_id, image_data,
+			(auth_mod_hash_img_start(image_id) == 0) ?
+			LOAD_IMAGE_HASHED : LOAD_IMAGE_WHOLE);
 	if (rc != 0) {
 		return rc;
 	}
@@ -196,7 +322,17 @@ static int load_auth_image_internal(unsigned int image_id,
 	}
 #endif
 
-	return load_image(image_id, image_data);
+#if !MEASURED_BOOT
+	/*
+	 * The image does not need to be in memory once loaded, so it can be
+	 * consumed by the pipeline registered for it, if any.
+	 */
+	if ((load_pipeline != NULL) && (load_pipeline_image == image_data)) {
+		return load_image(image_id, image_data, LOAD_IMAGE_PIPELINED);
+	}
+#endif
+
+	return load_image(image_id, image_data, LOAD_IMAGE_WHOLE);
 }
 
 /*******************************************************************************
@@ -223,6 +359,9 @@ int load_auth_image(unsigned int image_id, image_info_t *image_data)
 	} while ((err != 0) && (plat_try_next_boot_source() != 0));
 #endif /* PSA_FWU_SUPPORT */
 
+	/* A pipeline only applies to a single image */
+	load_image_set_pipeline(NULL, NULL);
+
 	if (err == 0) {
 		/*
 		 * If loading of the image gets passed (along with its
@@ -230,6 +369,13 @@ int load_auth_image(unsigned int image_id, image_info_t *image_data)
 		 * it (if MEASURED_BOOT flag is enabled).
 		 */
 		err = plat_mboot_measure_image(image_id, image_data);
+#if TRUSTED_BOARD_BOOT
+		/*
+		 * The hash kept from the authentication of the image does not
+		 * apply once it has been measured.
+		 */
+		crypto_mod_drop_hash();
+#endif
 		if (err != 0) {
 			return err;
 		}
@@ -1,10 +1,11 @@
 /*
- * Copyright (c) 2018, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2018-2023, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <arch_helpers.h>
@@ -12,11 +13,31 @@
 #include <common/debug.h>
 #include <common/image_decompress.h>
 
+/*
+ * Size of each of the two staging buffers used when the image is decompressed
+ * while it is being loaded.
+ */
+#ifndef IMAGE_DECOMPRESS_CHUNK_SIZE
+#define IMAGE_DECOMPRESS_CHUNK_SIZE	U(0x10000)
+#endif
+
 static uintptr_t decompressor_buf_base;
 static uint32_t decompressor_buf_size;
 static decompressor_t *decompressor;
+static const decompressor_stream_t *stream_decompressor;
+static bool stream_started;
 static struct image_info saved_image_info;
 
+static int image_decompress_stream_start(void);
+static int image_decompress_stream_chunk(uintptr_t chunk_base,
+					 size_t chunk_size);
+
+static image_load_pipeline_t decompress_pipeline = {
+	.chunk_size = IMAGE_DECOMPRESS_CHUNK_SIZE,
+	.start = image_decompress_stream_start,
+	.process = image_decompress_stream_chunk,
+};
+
 void image_decompress_init(uintptr_t buf_base, uint32_t buf_size,
 			   decompressor_t *_decompressor)
 {
@@ -25,6 +46,46 @@ void image_decompress_init(uintptr_t buf_base, uint32_t buf_size,
 	decompressor = _decompressor;
 }
 
+/*
+ * Optionally provide a decompressor that can be fed as the image is loaded.
+ * The temporary buffer passed to image_decompress_init() then holds two
+ * staging buffers of IMAGE_DECOMPRESS_CHUNK_SIZE bytes followed by the
+ * workspace of the decompressor. The one-shot decompressor is still used
+ * when the image has to be kept whole after loading, e.g. to be
+ * authenticated.
+ */
+void image_decompress_init_stream(const decompressor_stream_t *stream)
+{
+	assert(decompressor_buf_size > (2U * IMAGE_DECOMPRESS_CHUNK_SIZE));
+
+	decompress_pipeline.buf_base = decompressor_buf_base;
+	stream_decompressor = stream;
+}
+
+/* Called by load_image() before the first chunk of the compressed image */
+static int image_decompress_stream_start(void)
+{
+	uintptr_t work_base;
+	size_t work_size;
+
+	/* The workspace follows the two staging buffers */
+	work_base = decompressor_buf_base + (2U * IMAGE_DECOMPRESS_CHUNK_SIZE);
+	work_size = decompressor_buf_size - (2U * IMAGE_DECOMPRESS_CHUNK_SIZE);
+
+	stream_started = true;
+
+	return stream_decompressor->init(saved_image_info.image_base,
+					 saved_image_info.image_max_size,
+					 work_base, work_size);
+}
+
+/* Called by load_image() for each chunk of the compressed image */
+static int image_decompress_stream_chunk(uintptr_t chunk_base,
+					 size_t chunk_size)
+{
+	return stream_decompressor->update(chunk_base, chunk_size);
+}
+
 void image_decompress_prepare(struct image_info *info)
 {
 	/*
@@ -36,6 +97,37 @@ void image_decompress_prepare(struct image_info *info)
 	saved_image_info = *info;
 	info->image_base = decompressor_buf_base;
 	info->image_max_size = decompressor_buf_size;
+
+	/*
+	 * If possible, have load_image() pass the compressed data to the
+	 * decompressor chunk by chunk as it is read instead.
+	 */
+	stream_started = false;
+	if (stream_decompressor != NULL) {
+		load_image_set_pipeline(info, &decompress_pipeline);
+	}
+}
+
+/* Complete a decompression done while the image was loaded */
+static int image_decompress_stream_finish(struct image_info *info)
+{
+	uintptr_t image_end;
+	int ret;
+
+	*info = saved_image_info;
+	stream_started = false;
+
+	ret = stream_decompressor->finish(&image_end);
+	if (ret) {
+		ERROR("Failed to decompress image (err=%d)\n", ret);
+		return ret;
+	}
+
+	info->image_size = image_end - info->image_base;
+
+	flush_dcache_range(info->image_base, info->image_size);
+
+	return 0;
 }
 
 int image_decompress(struct image_info *info)
@@ -44,6 +136,10 @@ int image_decompress(struct image_info *info)
 	uint32_t compressed_image_size, work_size;
 	int ret;
 
+	if (stream_started) {
+		return image_decompress_stream_finish(info);
+	}
+
 	/*
 	 * The size of compressed data has been filled by load_image().
 	 * Read it out before restoring image_info.
@@ -1,10 +1,11 @@
 /*
- * Copyright (c) 2015-2023, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
 #include <assert.h>
+#include <limits.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -27,6 +28,16 @@
 
 #pragma weak plat_set_nv_ctr2
 
+/*
+ * State of the hash of a raw image calculated while the image is loaded. See
+ * auth_mod_hash_img_start().
+ */
+static struct {
+	unsigned int img_id;
+	unsigned int len;
+	bool active;
+} img_hash;
+
 static int cmp_auth_param_type_desc(const auth_param_type_desc_t *a,
 		const auth_param_type_desc_t *b)
 {
@@ -113,15 +124,28 @@ static int auth_hash(const auth_method_param_hash_t *param,
 		return rc;
 	}
 
-	/* Ask the crypto module to verify this hash */
-	rc = crypto_mod_verify_hash(data_ptr, data_len,
-				    hash_der_ptr, hash_der_len);
+	/*
+	 * Ask the crypto module to verify this hash. If it has already been
+	 * calculated over the same data while the image was loaded, only
+	 * the comparison remains to be done.
+	 */
+	if (img_hash.active && (img_hash.img_id == img_desc->img_id) &&
+	    (data_ptr == img) && (data_len == img_hash.len)) {
+		img_hash.active = false;
+		rc = crypto_mod_verify_hash_final(hash_der_ptr, hash_der_len);
+	} else {
+		rc = crypto_mod_verify_hash(data_ptr, data_len,
+					    hash_der_ptr, hash_der_len);
+	}
 	if (rc != 0) {
 		VERBOSE("[TBB] %s():%d failed with error code %d.\n",
 			__func__, __LINE__, rc);
 		return rc;
 	}
 
+	/* Keep the hash so that measuring the same data does not redo it */
+	crypto_mod_keep_hash(data_ptr, data_len);
+
 	return 0;
 }
 
@@ -448,6 +472,80 @@ void auth_mod_init(void)
 	img_parser_init();
 }
 
+/*
+ * Start calculating the hash used to authenticate an image, so that it can be
+ * fed with auth_mod_hash_img_update() as the image is being loaded. This is
+ * only possible for raw images authenticated by hash, once their parent has
+ * been authenticated, and if the crypto library supports it.
+ *
+ * Return: 0 = hash started, Otherwise = the image must be hashed by
+ * auth_mod_verify_img() as usual
+ */
+int auth_mod_hash_img_start(unsigned int img_id)
+{
+	const auth_img_desc_t *img_desc;
+	const auth_method_desc_t *auth_method;
+	void *hash_der_ptr;
+	unsigned int hash_der_len;
+	int rc, i;
+
+	img_hash.active = false;
+
+	img_desc = FCONF_GET_PROPERTY(tbbr, cot, img_id);
+	if ((img_desc->img_type != IMG_RAW) ||
+	    (img_desc->img_auth_methods == NULL)) {
+		return 1;
+	}
+
+	for (i = 0 ; i < AUTH_METHOD_NUM ; i++) {
+		auth_method = &img_desc->img_auth_methods[i];
+		if (auth_method->type == AUTH_METHOD_HASH) {
+			break;
+		}
+	}
+
+	if (i == AUTH_METHOD_NUM) {
+		return 1;
+	}
+
+	rc = auth_get_param(auth_method->param.hash.hash, img_desc->parent,
+			    &hash_der_ptr, &hash_der_len);
+	if (rc != 0) {
+		return rc;
+	}
+
+	rc = crypto_mod_verify_hash_init(hash_der_ptr, hash_der_len);
+	if (rc != 0) {
+		return rc;
+	}
+
+	img_hash.img_id = img_id;
+	img_hash.len = 0U;
+	img_hash.active = true;
+
+	return 0;
+}
+
+/*
+ * Add the next chunk of an image to the hash started with
+ * auth_mod_hash_img_start(). On failure the hash is abandoned and the image
+ * will be hashed by auth_mod_verify_img() as usual.
+ */
+void auth_mod_hash_img_update(void *data_ptr, unsigned int data_len)
+{
+	if (!img_hash.active) {
+		return;
+	}
+
+	if ((crypto_mod_verify_hash_update(data_ptr, data_len) != 0) ||
+	    (data_len > (UINT_MAX - img_hash.len))) {
+		img_hash.active = false;
+		return;
+	}
+
+	img_hash.len += data_len;
+}
+
 /*
  * Authenticate a certificate/image
  *
@@ -577,5 +675,8 @@ int auth_mod_verify_img(unsigned int img_id,
 	/* Mark image as authenticated */
 	auth_img_flags[img_desc->img_id] |= IMG_FLAG_AUTHENTICATED;
 
+	/* Drop any unused hash calculated while loading the image */
+	img_hash.active = false;
+
 	return 0;
 }
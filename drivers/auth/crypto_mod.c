@@ -1,13 +1,16 @@
 /*
- * Copyright (c) 2015-2023, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
 #include <assert.h>
+#include <stdbool.h>
+#include <string.h>
 
 #include <common/debug.h>
 #include <drivers/auth/crypto_mod.h>
+#include <lib/utils_def.h>
 
 /* Variable exported by the crypto library through REGISTER_CRYPTO_LIB() */
 
@@ -64,6 +67,219 @@ CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
 	INFO("Using crypto library '%s'\n", crypto_lib_desc.name);
 }
 
+#if CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY || \
+CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
+/*
+ * Size of the hashes calculated with a message digest algorithm
+ */
+unsigned int crypto_mod_md_size(enum crypto_md_algo alg)
+{
+	switch (alg) {
+	case CRYPTO_MD_SHA512:
+		return 64U;
+	case CRYPTO_MD_SHA384:
+		return 48U;
+	default:
+		return 32U;
+	}
+}
+#endif /* CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY || \
+	  CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
+
+#if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
+/*
+ * Hash of the data last verified by hash, calculated with the algorithm set by
+ * crypto_mod_set_kept_hash_alg(). When the algorithm is the same as the one
+ * the data was verified with, it is the hash held in the digest info.
+ * Otherwise it is calculated alongside the verification, in the same pass over
+ * the data.
+ *
+ * Once crypto_mod_keep_hash() has given the data it applies to, the next call
+ * to crypto_mod_calc_hash() over the same data returns it rather than hashing
+ * the data again.
+ */
+#define KEPT_HASH_NONE		0U
+#define KEPT_HASH_PENDING	1U	/* Hash known, data not given yet */
+#define KEPT_HASH_VALID		2U
+
+static struct {
+	enum crypto_md_algo alg;
+	bool alg_set;
+	/* A hash is being calculated with calc_hash_update() */
+	bool calc_active;
+	unsigned int state;
+	void *data_ptr;
+	unsigned int data_len;
+	unsigned char digest[CRYPTO_MD_MAX_SIZE];
+} kept_hash;
+
+/* Size of the chunks hashed with both algorithms while in the cache */
+#define KEPT_HASH_CHUNK_SIZE	U(0x4000)
+
+/*
+ * Called when the verification of a hash starts. If the hash to be kept uses a
+ * different algorithm, start calculating it.
+ */
+static void kept_hash_start(void *digest_info_ptr, unsigned int digest_info_len)
+{
+	enum crypto_md_algo alg;
+	unsigned char *digest;
+
+	kept_hash.state = KEPT_HASH_NONE;
+	kept_hash.calc_active = false;
+
+	if (!kept_hash.alg_set || (crypto_lib_desc.get_digest_info == NULL) ||
+	    (crypto_lib_desc.get_digest_info(digest_info_ptr, digest_info_len,
+					     &alg, &digest) != CRYPTO_SUCCESS)) {
+		return;
+	}
+
+	if ((alg == kept_hash.alg) || (crypto_lib_desc.calc_hash_init == NULL)) {
+		return;
+	}
+
+	kept_hash.calc_active =
+		crypto_lib_desc.calc_hash_init(kept_hash.alg) == CRYPTO_SUCCESS;
+}
+
+static void kept_hash_update(void *data_ptr, unsigned int data_len)
+{
+	if (kept_hash.calc_active &&
+	    (crypto_lib_desc.calc_hash_update(data_ptr, data_len) !=
+	     CRYPTO_SUCCESS)) {
+		kept_hash.calc_active = false;
+	}
+}
+
+/*
+ * Called when the verification of a hash ends with 'rc'. On success, the hash
+ * to be kept is taken from the digest info or from the hash calculated along.
+ */
+static void kept_hash_end(int rc, void *digest_info_ptr,
+			  unsigned int digest_info_len)
+{
+	enum crypto_md_algo alg;
+	unsigned char *digest;
+	bool calc_active = kept_hash.calc_active;
+
+	kept_hash.calc_active = false;
+
+	if ((rc != CRYPTO_SUCCESS) || !kept_hash.alg_set ||
+	    (crypto_lib_desc.get_digest_info == NULL) ||
+	    (crypto_lib_desc.get_digest_info(digest_info_ptr, digest_info_len,
+					     &alg, &digest) != CRYPTO_SUCCESS)) {
+		return;
+	}
+
+	if (alg == kept_hash.alg) {
+		(void)memcpy(kept_hash.digest, digest, crypto_mod_md_size(alg));
+		kept_hash.state = KEPT_HASH_PENDING;
+	} else if (calc_active &&
+		   (crypto_lib_desc.calc_hash_final(kept_hash.digest) ==
+		    CRYPTO_SUCCESS)) {
+		kept_hash.state = KEPT_HASH_PENDING;
+	}
+}
+
+/*
+ * Verify a hash incrementally, chunk by chunk, so that each chunk is also
+ * added to the hash to be kept while it is in the cache.
+ */
+static int verify_hash_chunks(void *data_ptr, unsigned int data_len,
+			      void *digest_info_ptr,
+			      unsigned int digest_info_len)
+{
+	uint8_t *p = data_ptr;
+	unsigned int chunk;
+	int rc;
+
+	rc = crypto_lib_desc.verify_hash_init(digest_info_ptr, digest_info_len);
+	if (rc != CRYPTO_SUCCESS) {
+		return rc;
+	}
+
+	while (data_len != 0U) {
+		chunk = MIN(data_len, KEPT_HASH_CHUNK_SIZE);
+
+		rc = crypto_lib_desc.verify_hash_update(p, chunk);
+		if (rc != CRYPTO_SUCCESS) {
+			return rc;
+		}
+		kept_hash_update(p, chunk);
+
+		p += chunk;
+		data_len -= chunk;
+	}
+
+	return crypto_lib_desc.verify_hash_final(digest_info_ptr,
+						 digest_info_len);
+}
+
+/*
+ * Have the hash of the data verified by hash be also kept for the given
+ * algorithm, so that measuring the same data does not hash it again. This is
+ * meant to be called by the measured boot driver with the algorithm it uses.
+ */
+void crypto_mod_set_kept_hash_alg(enum crypto_md_algo alg)
+{
+	kept_hash.alg = alg;
+	kept_hash.alg_set = true;
+}
+
+/*
+ * Bind the hash kept from the last successful verification to the data it was
+ * calculated over. It is dropped if there is none.
+ *
+ * Parameters:
+ *
+ *   data_ptr, data_len: data that was verified
+ */
+void crypto_mod_keep_hash(void *data_ptr, unsigned int data_len)
+{
+	if (kept_hash.state != KEPT_HASH_PENDING) {
+		kept_hash.state = KEPT_HASH_NONE;
+		return;
+	}
+
+	kept_hash.data_ptr = data_ptr;
+	kept_hash.data_len = data_len;
+	kept_hash.state = KEPT_HASH_VALID;
+}
+
+/*
+ * Drop the kept hash, once the data it was calculated over may change.
+ */
+void crypto_mod_drop_hash(void)
+{
+	kept_hash.state = KEPT_HASH_NONE;
+}
+
+/*
+ * Copy the kept hash to 'output' if it was calculated with 'alg' over the
+ * given data. It can only be used once.
+ */
+static bool kept_hash_take(enum crypto_md_algo alg, void *data_ptr,
+			   unsigned int data_len, unsigned char *output)
+{
+	if ((kept_hash.state != KEPT_HASH_VALID) || (kept_hash.alg != alg) ||
+	    (kept_hash.data_ptr != data_ptr) ||
+	    (kept_hash.data_len != data_len)) {
+		return false;
+	}
+
+	(void)memcpy(output, kept_hash.digest, crypto_mod_md_size(alg));
+	kept_hash.state = KEPT_HASH_NONE;
+
+	return true;
+}
+#elif CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY
+static bool kept_hash_take(enum crypto_md_algo alg, void *data_ptr,
+			   unsigned int data_len, unsigned char *output)
+{
+	return false;
+}
+#endif /* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
+
 #if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_ONLY || \
 CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
 /*
@@ -112,8 +328,114 @@ int crypto_mod_verify_hash(void *data_ptr, unsigned int data_len,
 	assert(digest_info_ptr != NULL);
 	assert(digest_info_len != 0);
 
+#if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
+	int rc;
+
+	kept_hash_start(digest_info_ptr, digest_info_len);
+	if (kept_hash.calc_active && (crypto_lib_desc.verify_hash_init != NULL)) {
+		rc = verify_hash_chunks(data_ptr, data_len,
+					digest_info_ptr, digest_info_len);
+	} else {
+		rc = crypto_lib_desc.verify_hash(data_ptr, data_len,
+						 digest_info_ptr,
+						 digest_info_len);
+	}
+	kept_hash_end(rc, digest_info_ptr, digest_info_len);
+
+	return rc;
+#else
 	return crypto_lib_desc.verify_hash(data_ptr, data_len,
 					   digest_info_ptr, digest_info_len);
+#endif
+}
+
+/*
+ * Start the verification of a hash calculated incrementally. Fails if the
+ * library does not support it.
+ *
+ * Parameters:
+ *
+ *   digest_info_ptr, digest_info_len: hash to be compared
+ */
+int crypto_mod_verify_hash_init(void *digest_info_ptr,
+				unsigned int digest_info_len)
+{
+	assert(digest_info_ptr != NULL);
+	assert(digest_info_len != 0);
+
+	if (crypto_lib_desc.verify_hash_init == NULL) {
+		return CRYPTO_ERR_UNKNOWN;
+	}
+
+#if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
+	int rc;
+
+	rc = crypto_lib_desc.verify_hash_init(digest_info_ptr,
+					      digest_info_len);
+	if (rc == CRYPTO_SUCCESS) {
+		kept_hash_start(digest_info_ptr, digest_info_len);
+	}
+
+	return rc;
+#else
+	return crypto_lib_desc.verify_hash_init(digest_info_ptr,
+						digest_info_len);
+#endif
+}
+
+/*
+ * Add data to a hash started with crypto_mod_verify_hash_init()
+ *
+ * Parameters:
+ *
+ *   data_ptr, data_len: data to be hashed
+ */
+int crypto_mod_verify_hash_update(void *data_ptr, unsigned int data_len)
+{
+	assert(crypto_lib_desc.verify_hash_update != NULL);
+	assert(data_ptr != NULL);
+	assert(data_len != 0);
+
+#if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
+	int rc;
+
+	rc = crypto_lib_desc.verify_hash_update(data_ptr, data_len);
+	if (rc == CRYPTO_SUCCESS) {
+		kept_hash_update(data_ptr, data_len);
+	}
+
+	return rc;
+#else
+	return crypto_lib_desc.verify_hash_update(data_ptr, data_len);
+#endif
+}
+
+/*
+ * Complete a hash started with crypto_mod_verify_hash_init() and compare it
+ *
+ * Parameters:
+ *
+ *   digest_info_ptr, digest_info_len: hash to be compared
+ */
+int crypto_mod_verify_hash_final(void *digest_info_ptr,
+				 unsigned int digest_info_len)
+{
+	assert(crypto_lib_desc.verify_hash_final != NULL);
+	assert(digest_info_ptr != NULL);
+	assert(digest_info_len != 0);
+
+#if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
+	int rc;
+
+	rc = crypto_lib_desc.verify_hash_final(digest_info_ptr,
+					       digest_info_len);
+	kept_hash_end(rc, digest_info_ptr, digest_info_len);
+
+	return rc;
+#else
+	return crypto_lib_desc.verify_hash_final(digest_info_ptr,
+						 digest_info_len);
+#endif
 }
 #endif /* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_ONLY || \
 	  CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
@@ -137,8 +459,81 @@ int crypto_mod_calc_hash(enum crypto_md_algo alg, void *data_ptr,
 	assert(data_len != 0);
 	assert(output != NULL);
 
+	/* Return the hash kept from the verification of the same data */
+	if (kept_hash_take(alg, data_ptr, data_len, output)) {
+		return CRYPTO_SUCCESS;
+	}
+
 	return crypto_lib_desc.calc_hash(alg, data_ptr, data_len, output);
 }
+
+/*
+ * Calculate the hashes of the same data with several algorithms. If the
+ * library supports it, they are calculated in a single pass over the data.
+ *
+ * Parameters:
+ *
+ *   algs, count: message digest algorithms
+ *   data_ptr, data_len: data to be hashed
+ *   output: resulting hashes, back to back in the order of 'algs'
+ */
+int crypto_mod_calc_hash_multi(const enum crypto_md_algo *algs,
+			       unsigned int count, void *data_ptr,
+			       unsigned int data_len, unsigned char *output)
+{
+	enum crypto_md_algo calc_algs[CRYPTO_MD_MAX_COUNT];
+	unsigned char *calc_output[CRYPTO_MD_MAX_COUNT];
+	unsigned char hashes[CRYPTO_MD_MAX_COUNT * CRYPTO_MD_MAX_SIZE];
+	unsigned char *p = hashes;
+	unsigned int i, n_calc = 0U;
+	int rc;
+
+	assert(algs != NULL);
+	assert((count != 0U) && (count <= CRYPTO_MD_MAX_COUNT));
+	assert(data_ptr != NULL);
+	assert(data_len != 0);
+	assert(output != NULL);
+
+	for (i = 0U; i < count; i++) {
+		if (!kept_hash_take(algs[i], data_ptr, data_len, output)) {
+			calc_algs[n_calc] = algs[i];
+			calc_output[n_calc] = output;
+			n_calc++;
+		}
+		output += crypto_mod_md_size(algs[i]);
+	}
+
+	if (n_calc == 0U) {
+		return CRYPTO_SUCCESS;
+	}
+
+	if ((n_calc == 1U) || (crypto_lib_desc.calc_hash_multi == NULL)) {
+		for (i = 0U; i < n_calc; i++) {
+			rc = crypto_lib_desc.calc_hash(calc_algs[i], data_ptr,
+						       data_len, p);
+			if (rc != CRYPTO_SUCCESS) {
+				return rc;
+			}
+			(void)memcpy(calc_output[i], p,
+				     crypto_mod_md_size(calc_algs[i]));
+		}
+		return CRYPTO_SUCCESS;
+	}
+
+	rc = crypto_lib_desc.calc_hash_multi(calc_algs, n_calc, data_ptr,
+					     data_len, hashes);
+	if (rc != CRYPTO_SUCCESS) {
+		return rc;
+	}
+
+	for (i = 0U; i < n_calc; i++) {
+		(void)memcpy(calc_output[i], p,
+			     crypto_mod_md_size(calc_algs[i]));
+		p += crypto_mod_md_size(calc_algs[i]);
+	}
+
+	return CRYPTO_SUCCESS;
+}
 #endif /* CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY || \
 	  CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
 
@@ -1,10 +1,11 @@
 /*
- * Copyright (c) 2015-2023, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
 
@@ -155,19 +156,18 @@ end2:
 }
 
 /*
- * Match a hash
+ * Extract the hash algorithm and the hash from a digest info
  *
  * Digest info is passed in DER format following the ASN.1 structure detailed
  * above.
  */
-static int verify_hash(void *data_ptr, unsigned int data_len,
-		       void *digest_info_ptr, unsigned int digest_info_len)
+static int get_digest_info(void *digest_info_ptr, unsigned int digest_info_len,
+			   const mbedtls_md_info_t **md_info,
+			   unsigned char **hash)
 {
 	mbedtls_asn1_buf hash_oid, params;
 	mbedtls_md_type_t md_alg;
-	const mbedtls_md_info_t *md_info;
-	unsigned char *p, *end, *hash;
-	unsigned char data_hash[MBEDTLS_MD_MAX_SIZE];
+	unsigned char *p, *end;
 	size_t len;
 	int rc;
 
@@ -197,8 +197,8 @@ static int verify_hash(void *data_ptr, unsigned int data_len,
 		return CRYPTO_ERR_HASH;
 	}
 
-	md_info = mbedtls_md_info_from_type(md_alg);
-	if (md_info == NULL) {
+	*md_info = mbedtls_md_info_from_type(md_alg);
+	if (*md_info == NULL) {
 		return CRYPTO_ERR_HASH;
 	}
 
@@ -209,10 +209,32 @@ static int verify_hash(void *data_ptr, unsigned int data_len,
 	}
 
 	/* Length of hash must match the algorithm's size */
-	if (len != mbedtls_md_get_size(md_info)) {
+	if (len != mbedtls_md_get_size(*md_info)) {
 		return CRYPTO_ERR_HASH;
 	}
-	hash = p;
+	*hash = p;
+
+	return CRYPTO_SUCCESS;
+}
+
+/*
+ * Match a hash
+ *
+ * Digest info is passed in DER format following the ASN.1 structure detailed
+ * above.
+ */
+static int verify_hash(void *data_ptr, unsigned int data_len,
+		       void *digest_info_ptr, unsigned int digest_info_len)
+{
+	const mbedtls_md_info_t *md_info;
+	unsigned char *p, *hash;
+	unsigned char data_hash[MBEDTLS_MD_MAX_SIZE];
+	int rc;
+
+	rc = get_digest_info(digest_info_ptr, digest_info_len, &md_info, &hash);
+	if (rc != CRYPTO_SUCCESS) {
+		return rc;
+	}
 
 	/* Calculate the hash of the data */
 	p = (unsigned char *)data_ptr;
@@ -229,6 +251,110 @@ static int verify_hash(void *data_ptr, unsigned int data_len,
 
 	return CRYPTO_SUCCESS;
 }
+
+/*
+ * Context of the hash calculated incrementally between verify_hash_init() and
+ * verify_hash_final(). Only one such hash can be in progress at a time.
+ */
+static mbedtls_md_context_t verify_hash_ctx;
+static const mbedtls_md_info_t *verify_hash_md_info;
+static bool verify_hash_ctx_active;
+
+static void verify_hash_release(void)
+{
+	if (verify_hash_ctx_active) {
+		mbedtls_md_free(&verify_hash_ctx);
+		verify_hash_ctx_active = false;
+	}
+}
+
+/*
+ * Start a hash to be compared with the given digest info once all the data
+ * has been passed to verify_hash_update(). A hash already in progress is
+ * discarded.
+ */
+static int verify_hash_init(void *digest_info_ptr,
+			    unsigned int digest_info_len)
+{
+	const mbedtls_md_info_t *md_info;
+	unsigned char *hash;
+	int rc;
+
+	verify_hash_release();
+
+	rc = get_digest_info(digest_info_ptr, digest_info_len, &md_info, &hash);
+	if (rc != CRYPTO_SUCCESS) {
+		return rc;
+	}
+
+	mbedtls_md_init(&verify_hash_ctx);
+	verify_hash_md_info = md_info;
+	verify_hash_ctx_active = true;
+
+	rc = mbedtls_md_setup(&verify_hash_ctx, md_info, 0);
+	if (rc == 0) {
+		rc = mbedtls_md_starts(&verify_hash_ctx);
+	}
+
+	if (rc != 0) {
+		verify_hash_release();
+		return CRYPTO_ERR_HASH;
+	}
+
+	return CRYPTO_SUCCESS;
+}
+
+static int verify_hash_update(void *data_ptr, unsigned int data_len)
+{
+	if (!verify_hash_ctx_active) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	if (mbedtls_md_update(&verify_hash_ctx, data_ptr, data_len) != 0) {
+		verify_hash_release();
+		return CRYPTO_ERR_HASH;
+	}
+
+	return CRYPTO_SUCCESS;
+}
+
+/*
+ * Complete the hash in progress and match it with the digest info, which must
+ * use the same algorithm as the one passed to verify_hash_init().
+ */
+static int verify_hash_final(void *digest_info_ptr,
+			     unsigned int digest_info_len)
+{
+	const mbedtls_md_info_t *md_info;
+	unsigned char *hash;
+	unsigned char data_hash[MBEDTLS_MD_MAX_SIZE];
+	int rc;
+
+	if (!verify_hash_ctx_active) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	rc = get_digest_info(digest_info_ptr, digest_info_len, &md_info, &hash);
+	if ((rc != CRYPTO_SUCCESS) ||
+	    (md_info != verify_hash_md_info)) {
+		verify_hash_release();
+		return CRYPTO_ERR_HASH;
+	}
+
+	rc = mbedtls_md_finish(&verify_hash_ctx, data_hash);
+	verify_hash_release();
+	if (rc != 0) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	/* Compare values */
+	rc = memcmp(data_hash, hash, mbedtls_md_get_size(md_info));
+	if (rc != 0) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	return CRYPTO_SUCCESS;
+}
 #endif /* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_ONLY || \
 	  CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
 
@@ -276,9 +402,191 @@ static int calc_hash(enum crypto_md_algo md_algo, void *data_ptr,
 	 */
 	return mbedtls_md(md_info, data_ptr, data_len, output);
 }
+
+/*
+ * Calculate the hashes of the data with several algorithms. The data is
+ * passed chunk by chunk to all of them, so that it is only read once from
+ * memory.
+ */
+#define CALC_HASH_MULTI_CHUNK_SIZE	U(0x4000)
+
+static int calc_hash_multi(const enum crypto_md_algo *md_algos,
+			   unsigned int count, void *data_ptr,
+			   unsigned int data_len, unsigned char *output)
+{
+	mbedtls_md_context_t ctx[CRYPTO_MD_MAX_COUNT];
+	const mbedtls_md_info_t *md_info;
+	unsigned char *p = data_ptr;
+	unsigned int chunk, i, n_ctx = 0U;
+	int rc = CRYPTO_SUCCESS;
+
+	if (count > CRYPTO_MD_MAX_COUNT) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	for (i = 0U; i < count; i++) {
+		md_info = mbedtls_md_info_from_type(md_type(md_algos[i]));
+		if (md_info == NULL) {
+			rc = CRYPTO_ERR_HASH;
+			break;
+		}
+
+		mbedtls_md_init(&ctx[i]);
+		n_ctx++;
+		if ((mbedtls_md_setup(&ctx[i], md_info, 0) != 0) ||
+		    (mbedtls_md_starts(&ctx[i]) != 0)) {
+			rc = CRYPTO_ERR_HASH;
+			break;
+		}
+	}
+
+	while ((rc == CRYPTO_SUCCESS) && (data_len != 0U)) {
+		chunk = MIN(data_len, CALC_HASH_MULTI_CHUNK_SIZE);
+
+		for (i = 0U; i < count; i++) {
+			if (mbedtls_md_update(&ctx[i], p, chunk) != 0) {
+				rc = CRYPTO_ERR_HASH;
+				break;
+			}
+		}
+
+		p += chunk;
+		data_len -= chunk;
+	}
+
+	for (i = 0U; (rc == CRYPTO_SUCCESS) && (i < count); i++) {
+		if (mbedtls_md_finish(&ctx[i], output) != 0) {
+			rc = CRYPTO_ERR_HASH;
+			break;
+		}
+		md_info = mbedtls_md_info_from_type(md_type(md_algos[i]));
+		output += mbedtls_md_get_size(md_info);
+	}
+
+	for (i = 0U; i < n_ctx; i++) {
+		mbedtls_md_free(&ctx[i]);
+	}
+
+	return rc;
+}
 #endif /* CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY || \
 	  CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
 
+#if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
+/*
+ * Context of the hash calculated incrementally between calc_hash_init() and
+ * calc_hash_final(). It is separate from the context of verify_hash_init(), so
+ * that the same data can be hashed with two algorithms in a single pass.
+ */
+static mbedtls_md_context_t calc_hash_ctx;
+static bool calc_hash_ctx_active;
+
+static void calc_hash_release(void)
+{
+	if (calc_hash_ctx_active) {
+		mbedtls_md_free(&calc_hash_ctx);
+		calc_hash_ctx_active = false;
+	}
+}
+
+/*
+ * Start a hash to be returned by calc_hash_final() once all the data has been
+ * passed to calc_hash_update(). A hash already in progress is discarded.
+ */
+static int calc_hash_init(enum crypto_md_algo md_algo)
+{
+	const mbedtls_md_info_t *md_info;
+	int rc;
+
+	calc_hash_release();
+
+	md_info = mbedtls_md_info_from_type(md_type(md_algo));
+	if (md_info == NULL) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	mbedtls_md_init(&calc_hash_ctx);
+	calc_hash_ctx_active = true;
+
+	rc = mbedtls_md_setup(&calc_hash_ctx, md_info, 0);
+	if (rc == 0) {
+		rc = mbedtls_md_starts(&calc_hash_ctx);
+	}
+
+	if (rc != 0) {
+		calc_hash_release();
+		return CRYPTO_ERR_HASH;
+	}
+
+	return CRYPTO_SUCCESS;
+}
+
+static int calc_hash_update(void *data_ptr, unsigned int data_len)
+{
+	if (!calc_hash_ctx_active) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	if (mbedtls_md_update(&calc_hash_ctx, data_ptr, data_len) != 0) {
+		calc_hash_release();
+		return CRYPTO_ERR_HASH;
+	}
+
+	return CRYPTO_SUCCESS;
+}
+
+static int calc_hash_final(unsigned char output[CRYPTO_MD_MAX_SIZE])
+{
+	int rc;
+
+	if (!calc_hash_ctx_active) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	rc = mbedtls_md_finish(&calc_hash_ctx, output);
+	calc_hash_release();
+	if (rc != 0) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	return CRYPTO_SUCCESS;
+}
+
+/*
+ * Get the algorithm and the hash held in a digest info. Only the algorithms
+ * of 'enum crypto_md_algo' are accepted.
+ */
+static int digest_info_get(void *digest_info_ptr, unsigned int digest_info_len,
+			   enum crypto_md_algo *md_algo,
+			   unsigned char **digest_ptr)
+{
+	const mbedtls_md_info_t *md_info;
+	int rc;
+
+	rc = get_digest_info(digest_info_ptr, digest_info_len, &md_info,
+			     digest_ptr);
+	if (rc != CRYPTO_SUCCESS) {
+		return rc;
+	}
+
+	switch (mbedtls_md_get_type(md_info)) {
+	case MBEDTLS_MD_SHA512:
+		*md_algo = CRYPTO_MD_SHA512;
+		break;
+	case MBEDTLS_MD_SHA384:
+		*md_algo = CRYPTO_MD_SHA384;
+		break;
+	case MBEDTLS_MD_SHA256:
+		*md_algo = CRYPTO_MD_SHA256;
+		break;
+	default:
+		return CRYPTO_ERR_HASH;
+	}
+
+	return CRYPTO_SUCCESS;
+}
+#endif /* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
+
 #if TF_MBEDTLS_USE_AES_GCM
 /*
  * Stack based buffer allocation for decryption operation. It could
@@ -398,20 +706,35 @@ static int auth_decrypt(enum crypto_dec_algo dec_algo, void *data_ptr,
  */
 #if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
 #if TF_MBEDTLS_USE_AES_GCM
-REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash, calc_hash,
-		    auth_decrypt, NULL);
+REGISTER_CRYPTO_LIB_HASH_UPDATE(LIB_NAME, init, verify_signature, verify_hash,
+				calc_hash, auth_decrypt, NULL,
+				verify_hash_init, verify_hash_update,
+				verify_hash_final, calc_hash_init,
+				calc_hash_update, calc_hash_final,
+				calc_hash_multi, digest_info_get);
 #else
-REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash, calc_hash,
-		    NULL, NULL);
+REGISTER_CRYPTO_LIB_HASH_UPDATE(LIB_NAME, init, verify_signature, verify_hash,
+				calc_hash, NULL, NULL,
+				verify_hash_init, verify_hash_update,
+				verify_hash_final, calc_hash_init,
+				calc_hash_update, calc_hash_final,
+				calc_hash_multi, digest_info_get);
 #endif
 #elif CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_ONLY
 #if TF_MBEDTLS_USE_AES_GCM
-REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash, NULL,
-		    auth_decrypt, NULL);
+REGISTER_CRYPTO_LIB_HASH_UPDATE(LIB_NAME, init, verify_signature, verify_hash,
+				NULL, auth_decrypt, NULL,
+				verify_hash_init, verify_hash_update,
+				verify_hash_final, NULL, NULL, NULL, NULL,
+				NULL);
 #else
-REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash, NULL,
-		    NULL, NULL);
+REGISTER_CRYPTO_LIB_HASH_UPDATE(LIB_NAME, init, verify_signature, verify_hash,
+				NULL, NULL, NULL,
+				verify_hash_init, verify_hash_update,
+				verify_hash_final, NULL, NULL, NULL, NULL,
+				NULL);
 #endif
 #elif CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY
-REGISTER_CRYPTO_LIB(LIB_NAME, init, NULL, NULL, calc_hash, NULL, NULL);
+REGISTER_CRYPTO_LIB_HASH_MULTI(LIB_NAME, init, NULL, NULL, calc_hash, NULL,
+			       NULL, calc_hash_multi);
 #endif /* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, Arm Limited. All rights reserved.
+ * Copyright (c) 2023-2024, Arm Limited. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -553,6 +553,71 @@ static int calc_hash(enum crypto_md_algo md_algo, void *data_ptr,
 
 	return CRYPTO_SUCCESS;
 }
+
+/*
+ * Calculate the hashes of the data with several algorithms. The data is
+ * passed chunk by chunk to all of them, so that it is only read once from
+ * memory.
+ */
+#define CALC_HASH_MULTI_CHUNK_SIZE	U(0x4000)
+
+static int calc_hash_multi(const enum crypto_md_algo *md_algos,
+			   unsigned int count, void *data_ptr,
+			   unsigned int data_len, unsigned char *output)
+{
+	psa_hash_operation_t ops[CRYPTO_MD_MAX_COUNT];
+	psa_algorithm_t psa_md_alg;
+	const uint8_t *p = data_ptr;
+	size_t hash_length;
+	unsigned int chunk, i;
+	int rc = CRYPTO_SUCCESS;
+
+	if (count > CRYPTO_MD_MAX_COUNT) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	for (i = 0U; i < count; i++) {
+		ops[i] = psa_hash_operation_init();
+	}
+
+	for (i = 0U; i < count; i++) {
+		psa_md_alg = mbedtls_md_psa_alg_from_type(md_type(md_algos[i]));
+		if (psa_hash_setup(&ops[i], psa_md_alg) != PSA_SUCCESS) {
+			rc = CRYPTO_ERR_HASH;
+			break;
+		}
+	}
+
+	while ((rc == CRYPTO_SUCCESS) && (data_len != 0U)) {
+		chunk = MIN(data_len, CALC_HASH_MULTI_CHUNK_SIZE);
+
+		for (i = 0U; i < count; i++) {
+			if (psa_hash_update(&ops[i], p, chunk) != PSA_SUCCESS) {
+				rc = CRYPTO_ERR_HASH;
+				break;
+			}
+		}
+
+		p += chunk;
+		data_len -= chunk;
+	}
+
+	for (i = 0U; (rc == CRYPTO_SUCCESS) && (i < count); i++) {
+		if (psa_hash_finish(&ops[i], output, CRYPTO_MD_MAX_SIZE,
+				    &hash_length) != PSA_SUCCESS) {
+			rc = CRYPTO_ERR_HASH;
+			break;
+		}
+		output += hash_length;
+	}
+
+	/* Aborting a finished or unused operation has no effect */
+	for (i = 0U; i < count; i++) {
+		(void)psa_hash_abort(&ops[i]);
+	}
+
+	return rc;
+}
 #endif /*
 	* CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY || \
 	* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
@@ -677,11 +742,12 @@ static int auth_decrypt(enum crypto_dec_algo dec_algo, void *data_ptr,
  */
 #if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
 #if TF_MBEDTLS_USE_AES_GCM
-REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash, calc_hash,
-		    auth_decrypt, NULL);
+REGISTER_CRYPTO_LIB_HASH_MULTI(LIB_NAME, init, verify_signature, verify_hash,
+			       calc_hash, auth_decrypt, NULL,
+			       calc_hash_multi);
 #else
-REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash, calc_hash,
-		    NULL, NULL);
+REGISTER_CRYPTO_LIB_HASH_MULTI(LIB_NAME, init, verify_signature, verify_hash,
+			       calc_hash, NULL, NULL, calc_hash_multi);
 #endif
 #elif CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_ONLY
 #if TF_MBEDTLS_USE_AES_GCM
@@ -692,5 +758,6 @@ REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash, NULL,
 		    NULL, NULL);
 #endif
 #elif CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY
-REGISTER_CRYPTO_LIB(LIB_NAME, init, NULL, NULL, calc_hash, NULL, NULL);
+REGISTER_CRYPTO_LIB_HASH_MULTI(LIB_NAME, init, NULL, NULL, calc_hash, NULL,
+			       NULL, calc_hash_multi);
 #endif /* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
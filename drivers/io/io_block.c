@@ -1,11 +1,12 @@
 /*
- * Copyright (c) 2016-2023, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2016-2024, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
 #include <assert.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include <platform_def.h>
@@ -21,6 +22,10 @@ typedef struct {
 	uintptr_t		base;
 	unsigned long long	file_pos;
 	unsigned long long	size;
+	/* Block following the last one read, to detect sequential reads */
+	int			next_lba;
+	/* Incremented on each cache access, to find the least recently used */
+	unsigned int		cache_tick;
 } block_dev_state_t;
 
 #define is_power_of_2(x)	(((x) != 0U) && (((x) & ((x) - 1U)) == 0U))
@@ -30,6 +35,7 @@ io_type_t device_type_block(void);
 static int block_open(io_dev_info_t *dev_info, const uintptr_t spec,
 		      io_entity_t *entity);
 static int block_seek(io_entity_t *entity, int mode, signed long long offset);
+static int block_len(io_entity_t *entity, size_t *length);
 static int block_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 		      size_t *length_read);
 static int block_write(io_entity_t *entity, const uintptr_t buffer,
@@ -46,7 +52,7 @@ static const io_dev_funcs_t block_dev_funcs = {
 	.type		= device_type_block,
 	.open		= block_open,
 	.seek		= block_seek,
-	.size		= NULL,
+	.size		= block_len,
 	.read		= block_read,
 	.write		= block_write,
 	.close		= block_close,
@@ -171,6 +177,194 @@ static int block_seek(io_entity_t *entity, int mode, signed long long offset)
 	return 0;
 }
 
+/* Return the size of the region opened on the block device */
+static int block_len(io_entity_t *entity, size_t *length)
+{
+	assert((entity->info != (uintptr_t)NULL) && (length != NULL));
+
+	*length = (size_t)((block_dev_state_t *)entity->info)->size;
+
+	return 0;
+}
+
+/* Return the tag of the cache line holding block 'lba', or NULL */
+static io_block_cache_tag_t *cache_lookup(const io_block_cache_t *cache,
+					  int lba)
+{
+	io_block_cache_tag_t *tag;
+	unsigned int way;
+
+	tag = &cache->tags[((unsigned int)lba & (cache->sets - 1U)) *
+			   cache->ways];
+	for (way = 0U; way < cache->ways; way++) {
+		if (tag[way].valid && (tag[way].lba == lba)) {
+			return &tag[way];
+		}
+	}
+
+	return NULL;
+}
+
+/* Return the tag of the least recently used cache line for block 'lba' */
+static io_block_cache_tag_t *cache_victim(const io_block_cache_t *cache,
+					  int lba)
+{
+	io_block_cache_tag_t *tag, *victim;
+	unsigned int way;
+
+	tag = &cache->tags[((unsigned int)lba & (cache->sets - 1U)) *
+			   cache->ways];
+	victim = &tag[0];
+	for (way = 0U; way < cache->ways; way++) {
+		if (!tag[way].valid) {
+			return &tag[way];
+		}
+		if (tag[way].age < victim->age) {
+			victim = &tag[way];
+		}
+	}
+
+	return victim;
+}
+
+/* Return the address of the data of a cache line */
+static uintptr_t cache_line(const io_block_cache_t *cache,
+			    const io_block_cache_tag_t *tag, size_t block_size)
+{
+	return cache->data + ((size_t)(tag - cache->tags) * block_size);
+}
+
+/* Invalidate the cache lines holding blocks 'lba' to 'lba + nblocks - 1' */
+static void cache_invalidate(io_block_cache_t *cache, int lba, size_t nblocks)
+{
+	io_block_cache_tag_t *tag;
+	size_t i;
+
+	if (cache == NULL) {
+		return;
+	}
+
+	if (nblocks >= (cache->sets * cache->ways)) {
+		zeromem(cache->tags, cache->sets * cache->ways *
+			sizeof(io_block_cache_tag_t));
+		return;
+	}
+
+	for (i = 0U; i < nblocks; i++) {
+		tag = cache_lookup(cache, lba + (int)i);
+		if (tag != NULL) {
+			tag->valid = false;
+		}
+	}
+}
+
+/*
+ * Read 'size' bytes from block 'lba' into 'dst', with the same semantics as
+ * ops.read(), going through the block cache if the platform provides one.
+ *
+ * If the first block is in the cache, the following blocks are copied from
+ * the cache for as long as they are there. Otherwise the blocks are read
+ * through the device buffer, along with up to 'read_ahead' more blocks of the
+ * region if the read follows on from the previous one, and all of them are
+ * added to the cache. Reads too large for the device buffer or the cache go
+ * straight to the device.
+ */
+static size_t block_cache_read(block_dev_state_t *cur, int lba, uintptr_t dst,
+			       size_t size)
+{
+	const io_block_dev_spec_t *dev_spec = cur->dev_spec;
+	io_block_cache_t *cache = dev_spec->cache;
+	const io_block_spec_t *buf = &dev_spec->buffer;
+	size_t block_size = dev_spec->block_size;
+	size_t nblocks = size / block_size;
+	size_t ahead, request, nbytes, i;
+	unsigned long long end_lba;
+	io_block_cache_tag_t *tag;
+	bool sequential;
+
+	if (cache == NULL) {
+		return dev_spec->ops.read(lba, dst, size);
+	}
+
+	sequential = (lba == cur->next_lba);
+	cur->next_lba = lba + (int)nblocks;
+
+	for (i = 0U; i < nblocks; i++) {
+		tag = cache_lookup(cache, lba + (int)i);
+		if (tag == NULL) {
+			break;
+		}
+		tag->age = ++cur->cache_tick;
+		memcpy((void *)(dst + (i * block_size)),
+		       (void *)cache_line(cache, tag, block_size), block_size);
+	}
+
+	if (i != 0U) {
+		cache->hits += i;
+		return i * block_size;
+	}
+
+	cache->misses += nblocks;
+
+	if ((size > buf->length) ||
+	    (nblocks > (cache->sets * cache->ways))) {
+		return dev_spec->ops.read(lba, dst, size);
+	}
+
+	/*
+	 * Read ahead as far as the last full block of the region. There is
+	 * nothing to read ahead when this read reaches the end of the region,
+	 * or covers the partial block at its end.
+	 */
+	ahead = 0U;
+	end_lba = (cur->base + cur->size) / block_size;
+	if (sequential && ((unsigned long long)cur->next_lba < end_lba)) {
+		ahead = (size_t)(end_lba - (unsigned long long)cur->next_lba);
+		ahead = MIN(ahead, (size_t)cache->read_ahead);
+	}
+	request = MIN(size + (ahead * block_size), buf->length);
+	nbytes = dev_spec->ops.read(lba, buf->offset, request);
+	if (nbytes > request) {
+		return nbytes;
+	}
+
+	for (i = 0U; i < (nbytes / block_size); i++) {
+		tag = cache_lookup(cache, lba + (int)i);
+		if (tag == NULL) {
+			tag = cache_victim(cache, lba + (int)i);
+			tag->lba = lba + (int)i;
+			tag->valid = true;
+		}
+		tag->age = ++cur->cache_tick;
+		memcpy((void *)cache_line(cache, tag, block_size),
+		       (void *)(buf->offset + (i * block_size)), block_size);
+	}
+
+	nbytes = MIN(nbytes, size);
+	if (dst != buf->offset) {
+		memcpy((void *)dst, (void *)buf->offset, nbytes);
+	}
+
+	return nbytes;
+}
+
+/*
+ * Return true if 'left' bytes at the current file position can be read, at
+ * least in part, straight into 'dst' without going through the device buffer:
+ * the platform allows it, the file position is block-aligned, there is at
+ * least one whole block to read and 'dst' has the alignment required by the
+ * low level driver.
+ */
+static bool is_direct_read(const io_block_dev_spec_t *dev_spec, uintptr_t dst,
+			   size_t skip, size_t left)
+{
+	size_t align = dev_spec->direct_read_align;
+
+	return (align != 0U) && (skip == 0U) &&
+	       (left >= dev_spec->block_size) &&
+	       ((dst & (align - 1U)) == 0U);
+}
+
 /*
  * This function allows the caller to read any number of bytes
  * from any position. It hides from the caller that the low level
@@ -240,6 +434,11 @@ static int block_seek(io_entity_t *entity, int mode, signed long long offset)
  *
  * Additionally, the IO driver has an underlying buffer that is at least
  * one block-size and may be big enough to allow.
+ *
+ * If the platform sets dev_spec->direct_read_align, the whole blocks in
+ * between are read straight into the caller's buffer when it is suitably
+ * aligned, and only the leading and trailing partial blocks go through the
+ * underlying buffer.
  */
 static int block_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 		      size_t *length_read)
@@ -296,7 +495,36 @@ static int block_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 		 */
 		lba = (cur->file_pos + cur->base) / block_size;
 
-		if ((skip + left) > buf->length) {
+		if (is_direct_read(cur->dev_spec, buffer + count, skip, left)) {
+			/*
+			 * Read all the whole blocks left straight into the
+			 * caller's buffer. Only the trailing partial block,
+			 * if any, goes through the underlying read buffer.
+			 */
+			request = left & ~(block_size - 1U);
+			nbytes = block_cache_read(cur, lba, buffer + count,
+						  request);
+			if ((nbytes == 0U) || (nbytes > request)) {
+				return -EIO;
+			}
+
+			cur->file_pos += nbytes;
+			count += nbytes;
+			continue;
+		}
+
+		if ((skip > 0U) &&
+		    (skip + left > block_size) &&
+		    is_direct_read(cur->dev_spec,
+				   buffer + count + (block_size - skip), 0U,
+				   left - (block_size - skip))) {
+			/*
+			 * Only the leading partial block has to go through
+			 * the underlying read buffer, the following blocks
+			 * can be read directly.
+			 */
+			request = block_size;
+		} else if ((skip + left) > buf->length) {
 			/*
 			 * The underlying read buffer is too small to
 			 * read all the required data - limit to just
@@ -314,7 +542,7 @@ static int block_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 			request = (request + (block_size - 1U)) &
 				~(block_size - 1U);
 		}
-		request = ops->read(lba, buf->offset, request);
+		request = block_cache_read(cur, lba, buf->offset, request);
 
 		if (request <= skip) {
 			/*
@@ -468,6 +696,10 @@ static int block_write(io_entity_t *entity, const uintptr_t buffer,
 		       (void *)(buffer + count),
 		       nbytes);
 
+		/* Drop the cached copies of the blocks being written */
+		cache_invalidate(cur->dev_spec->cache, lba,
+				 request / block_size);
+
 		request = ops->write(lba, buf->offset, request);
 		if (request <= skip)
 			return -EIO;
@@ -501,6 +733,7 @@ static int block_dev_open(const uintptr_t dev_spec, io_dev_info_t **dev_info)
 {
 	block_dev_state_t *cur;
 	io_block_spec_t *buffer;
+	io_block_cache_t *cache;
 	io_dev_info_t *info;
 	size_t block_size;
 	int result;
@@ -519,6 +752,18 @@ static int block_dev_open(const uintptr_t dev_spec, io_dev_info_t **dev_info)
 	       (is_power_of_2(block_size) != 0U) &&
 	       ((buffer->offset % block_size) == 0U) &&
 	       ((buffer->length % block_size) == 0U));
+	assert((cur->dev_spec->direct_read_align == 0U) ||
+	       (is_power_of_2(cur->dev_spec->direct_read_align) != 0U));
+
+	cache = cur->dev_spec->cache;
+	if (cache != NULL) {
+		assert((cache->data != (uintptr_t)NULL) &&
+		       (cache->tags != NULL) &&
+		       (is_power_of_2(cache->sets) != 0U) &&
+		       (cache->ways > 0U));
+		/* The device content may have changed since the last use */
+		cache_invalidate(cache, 0, cache->sets * cache->ways);
+	}
 
 	*dev_info = info;	/* cast away const */
 	(void)block_size;
@@ -528,6 +773,16 @@ static int block_dev_open(const uintptr_t dev_spec, io_dev_info_t **dev_info)
 
 static int block_dev_close(io_dev_info_t *dev_info)
 {
+	const io_block_cache_t *cache;
+
+	assert(dev_info != NULL);
+
+	cache = ((block_dev_state_t *)dev_info->info)->dev_spec->cache;
+	if (cache != NULL) {
+		VERBOSE("Block cache: %lu hits, %lu misses\n",
+			cache->hits, cache->misses);
+	}
+
 	return free_dev_info(dev_info);
 }
 
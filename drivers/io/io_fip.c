@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2014-2020, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2014-2023, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -25,6 +25,22 @@
 #define MAX_FIP_DEVICES		1
 #endif
 
+/*
+ * Maximum number of files that can be open at the same time across all FIP
+ * devices.
+ */
+#ifndef MAX_FIP_FILES
+#define MAX_FIP_FILES		2
+#endif
+
+/*
+ * Maximum number of ToC entries (excluding the terminating null entry) that
+ * are cached per FIP device when the device is initialised.
+ */
+#ifndef MAX_FIP_TOC_ENTRIES
+#define MAX_FIP_TOC_ENTRIES	32
+#endif
+
 /* Useful for printing UUIDs when debugging.*/
 #define PRINT_UUID2(x)								\
 	"%08x-%04hx-%04hx-%02hhx%02hhx-%02hhx%02hhx%02hhx%02hhx%02hhx%02hhx",	\
@@ -33,32 +49,36 @@
 		x.node[0], x.node[1], x.node[2], x.node[3],			\
 		x.node[4], x.node[5]
 
-typedef struct {
-	unsigned int file_pos;
-	fip_toc_entry_t entry;
-} fip_file_state_t;
-
 /*
- * Maintain dev_spec per FIP Device
- * TODO - Add backend handles and file state
- * per FIP device here once backends like io_memmap
- * can support multiple open files
+ * Maintain dev_spec per FIP Device, along with a copy of the Table of
+ * Contents read when the device is initialised. The ToC entries are kept
+ * sorted by UUID so that files can be located without accessing the backend.
+ *
+ * Backends like io_memmap only support one open file, so a single backend
+ * handle is shared by all the files open on a FIP device. It is opened with
+ * the first file and closed with the last one.
  */
 typedef struct {
 	uintptr_t dev_spec;
 	uint16_t plat_toc_flag;
+	uintptr_t backend_dev_handle;
+	uintptr_t backend_image_spec;
+	uintptr_t backend_handle;
+	unsigned int open_files;
+	unsigned int toc_entry_count;
+	/* Room for the terminating null entry too */
+	fip_toc_entry_t toc[MAX_FIP_TOC_ENTRIES + 1U];
 } fip_dev_state_t;
 
-/*
- * Only one file can be open across all FIP device
- * as backends like io_memmap don't support
- * multiple open files. The file state and
- * backend handle should be maintained per FIP device
- * if the same support is available in the backend
- */
-static fip_file_state_t current_fip_file = {0};
-static uintptr_t backend_dev_handle;
-static uintptr_t backend_image_spec;
+/* File state, in use while 'dev_state' is not NULL */
+typedef struct {
+	fip_dev_state_t *dev_state;
+	unsigned int file_pos;
+	fip_toc_entry_t entry;
+} fip_file_state_t;
+
+/* Pool of file states shared by all FIP devices */
+static fip_file_state_t file_state_pool[MAX_FIP_FILES];
 
 static fip_dev_state_t state_pool[MAX_FIP_DEVICES];
 static io_dev_info_t dev_info_pool[MAX_FIP_DEVICES];
@@ -95,6 +115,146 @@ static inline int is_valid_header(fip_toc_header_t *header)
 }
 
 
+/* Sort the cached ToC entries by UUID, using an insertion sort. */
+static void sort_toc_entries(fip_dev_state_t *state)
+{
+	unsigned int i, j;
+	fip_toc_entry_t tmp;
+
+	for (i = 1U; i < state->toc_entry_count; i++) {
+		tmp = state->toc[i];
+		for (j = i; j > 0U; j--) {
+			if (compare_uuids(&state->toc[j - 1U].uuid,
+					  &tmp.uuid) <= 0) {
+				break;
+			}
+			state->toc[j] = state->toc[j - 1U];
+		}
+		state->toc[j] = tmp;
+	}
+}
+
+
+/* Binary search the cached ToC for an entry matching the given UUID. */
+static const fip_toc_entry_t *find_toc_entry(const fip_dev_state_t *state,
+					     const uuid_t *uuid)
+{
+	unsigned int low = 0U;
+	unsigned int high = state->toc_entry_count;
+	unsigned int mid;
+	int cmp;
+
+	while (low < high) {
+		mid = low + ((high - low) / 2U);
+		cmp = compare_uuids(&state->toc[mid].uuid, uuid);
+		if (cmp == 0) {
+			return &state->toc[mid];
+		} else if (cmp < 0) {
+			low = mid + 1U;
+		} else {
+			high = mid;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Read the Table of Contents that follows the FIP header into the device
+ * state. The backend handle is expected to point just past the header. The
+ * whole ToC is fetched with as few reads as possible, bounded by the size of
+ * the backend when it is known.
+ */
+static int read_toc(uintptr_t backend_handle, fip_dev_state_t *state)
+{
+	static const uuid_t uuid_null = { {0} }; /* Double braces for clang */
+	size_t backend_size;
+	size_t toc_size = sizeof(state->toc);
+	size_t bytes_read;
+	unsigned int i, nr_entries;
+	int result;
+
+	state->toc_entry_count = 0U;
+
+	/* Do not read past the end of the backend, if its size is known */
+	if ((io_size(backend_handle, &backend_size) == 0) &&
+	    (backend_size > sizeof(fip_toc_header_t))) {
+		backend_size -= sizeof(fip_toc_header_t);
+		if (backend_size < toc_size) {
+			toc_size = backend_size - (backend_size %
+						   sizeof(fip_toc_entry_t));
+		}
+	}
+
+	if (toc_size == 0U) {
+		WARN("Firmware Image Package has no ToC\n");
+		return -ENOENT;
+	}
+
+	result = io_read(backend_handle, (uintptr_t)state->toc, toc_size,
+			 &bytes_read);
+	if (result != 0) {
+		WARN("Failed to read FIP ToC (%i)\n", result);
+		return -ENOENT;
+	}
+
+	nr_entries = (unsigned int)(bytes_read / sizeof(fip_toc_entry_t));
+	for (i = 0U; i < nr_entries; i++) {
+		if (compare_uuids(&state->toc[i].uuid, &uuid_null) == 0) {
+			break;
+		}
+	}
+
+	if (i == nr_entries) {
+		/* No terminating entry found in the space available */
+		WARN("FIP ToC exceeds %u entries, check MAX_FIP_TOC_ENTRIES\n",
+		     nr_entries - 1U);
+		return -ENOMEM;
+	}
+
+	state->toc_entry_count = i;
+	sort_toc_entries(state);
+
+	VERBOSE("FIP ToC cached (%u entries)\n", state->toc_entry_count);
+
+	return 0;
+}
+
+
+/* Allocate a file state from the pool */
+static fip_file_state_t *allocate_file_state(fip_dev_state_t *state)
+{
+	unsigned int index;
+
+	for (index = 0U; index < (unsigned int)MAX_FIP_FILES; ++index) {
+		if (file_state_pool[index].dev_state == NULL) {
+			file_state_pool[index].dev_state = state;
+			return &file_state_pool[index];
+		}
+	}
+
+	return NULL;
+}
+
+
+/* Release a file state to the pool */
+static void free_file_state(fip_file_state_t *fp)
+{
+	zeromem(fp, sizeof(fip_file_state_t));
+}
+
+
+/* Close the backend handle of a FIP device, if open */
+static void close_backend(fip_dev_state_t *state)
+{
+	if (state->backend_handle != (uintptr_t)NULL) {
+		(void)io_close(state->backend_handle);
+		state->backend_handle = (uintptr_t)NULL;
+	}
+}
+
+
 /* Identify the device type as a virtual driver */
 static io_type_t device_type_fip(void)
 {
@@ -183,8 +343,8 @@ static int free_dev_info(io_dev_info_t *dev_info)
 
 /*
  * Multiple FIP devices can be opened depending on the value of
- * MAX_FIP_DEVICES. Given that there is only one backend, only a
- * single file can be open at a time by any FIP device.
+ * MAX_FIP_DEVICES. Up to MAX_FIP_FILES files can be open at a time
+ * across all FIP devices.
  */
 static int fip_dev_open(const uintptr_t dev_spec,
 			 io_dev_info_t **dev_info)
@@ -212,7 +372,7 @@ static int fip_dev_open(const uintptr_t dev_spec,
 }
 
 
-/* Do some basic package checks. */
+/* Do some basic package checks and cache the Table of Contents. */
 static int fip_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 {
 	int result;
@@ -226,9 +386,17 @@ static int fip_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 
 	state = (fip_dev_state_t *)dev_info->info;
 
+	/*
+	 * The backend and the cached ToC are in use by open files, keep using
+	 * them rather than re-initialising the device underneath.
+	 */
+	if (state->open_files != 0U) {
+		return 0;
+	}
+
 	/* Obtain a reference to the image by querying the platform layer */
-	result = plat_get_image_source(image_id, &backend_dev_handle,
-				       &backend_image_spec);
+	result = plat_get_image_source(image_id, &state->backend_dev_handle,
+				       &state->backend_image_spec);
 	if (result != 0) {
 		WARN("Failed to obtain reference to image id=%u (%i)\n",
 			image_id, result);
@@ -237,7 +405,7 @@ static int fip_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 	}
 
 	/* Attempt to access the FIP image */
-	result = io_open(backend_dev_handle, backend_image_spec,
+	result = io_open(state->backend_dev_handle, state->backend_image_spec,
 			 &backend_handle);
 	if (result != 0) {
 		WARN("Failed to access image id=%u (%i)\n", image_id, result);
@@ -258,6 +426,7 @@ static int fip_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 			 * bits [32-47] in fip header.
 			 */
 			state->plat_toc_flag = (header.flags >> 32) & 0xffff;
+			result = read_toc(backend_handle, state);
 		}
 	}
 
@@ -270,11 +439,22 @@ static int fip_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 /* Close a connection to the FIP device */
 static int fip_dev_close(io_dev_info_t *dev_info)
 {
-	/* TODO: Consider tracking open files and cleaning them up here */
+	fip_dev_state_t *state;
+	unsigned int index;
+
+	assert(dev_info != NULL);
 
-	/* Clear the backend. */
-	backend_dev_handle = (uintptr_t)NULL;
-	backend_image_spec = (uintptr_t)NULL;
+	state = (fip_dev_state_t *)dev_info->info;
+
+	/* Release any file still open on this device, then the backend. */
+	for (index = 0U; index < (unsigned int)MAX_FIP_FILES; ++index) {
+		if (file_state_pool[index].dev_state == state) {
+			WARN("FIP device closed with open files\n");
+			free_file_state(&file_state_pool[index]);
+		}
+	}
+
+	close_backend(state);
 
 	return free_dev_info(dev_info);
 }
@@ -285,81 +465,55 @@ static int fip_file_open(io_dev_info_t *dev_info, const uintptr_t spec,
 			 io_entity_t *entity)
 {
 	int result;
-	uintptr_t backend_handle;
 	const io_uuid_spec_t *uuid_spec = (io_uuid_spec_t *)spec;
-	static const uuid_t uuid_null = { {0} }; /* Double braces for clang */
-	size_t bytes_read;
-	int found_file = 0;
+	const fip_toc_entry_t *toc_entry;
+	fip_dev_state_t *state;
+	fip_file_state_t *fp;
 
+	assert(dev_info != NULL);
 	assert(uuid_spec != NULL);
 	assert(entity != NULL);
 
-	/* Can only have one file open at a time for the moment. We need to
-	 * track state like file cursor position. We know the header lives at
-	 * offset zero, so this entry should never be zero for an active file.
-	 * When the system supports dynamic memory allocation we can allow more
-	 * than one open file at a time if needed.
-	 */
-	if (current_fip_file.entry.offset_address != 0U) {
-		WARN("fip_file_open : Only one open file at a time.\n");
-		return -ENFILE;
-	}
+	state = (fip_dev_state_t *)dev_info->info;
 
-	/* Attempt to access the FIP image */
-	result = io_open(backend_dev_handle, backend_image_spec,
-			 &backend_handle);
-	if (result != 0) {
-		WARN("Failed to open Firmware Image Package (%i)\n", result);
-		result = -ENOENT;
-		goto fip_file_open_exit;
+	/* Look the file up in the ToC cached by fip_dev_init() */
+	toc_entry = find_toc_entry(state, &uuid_spec->uuid);
+	if (toc_entry == NULL) {
+		/* Did not find the file in the FIP. */
+		return -ENOENT;
 	}
 
-	/* Seek past the FIP header into the Table of Contents */
-	result = io_seek(backend_handle, IO_SEEK_SET,
-			 (signed long long)sizeof(fip_toc_header_t));
-	if (result != 0) {
-		WARN("fip_file_open: failed to seek\n");
-		result = -ENOENT;
-		goto fip_file_open_close;
+	fp = allocate_file_state(state);
+	if (fp == NULL) {
+		WARN("fip_file_open: too many open files\n");
+		return -ENFILE;
 	}
 
-	found_file = 0;
-	do {
-		result = io_read(backend_handle,
-				 (uintptr_t)&current_fip_file.entry,
-				 sizeof(current_fip_file.entry),
-				 &bytes_read);
-		if (result == 0) {
-			if (compare_uuids(&current_fip_file.entry.uuid,
-					  &uuid_spec->uuid) == 0) {
-				found_file = 1;
-			}
-		} else {
-			WARN("Failed to read FIP (%i)\n", result);
-			goto fip_file_open_close;
+	/* The first file opened on the device gives access to the backend */
+	if (state->open_files == 0U) {
+		assert(state->backend_handle == (uintptr_t)NULL);
+		result = io_open(state->backend_dev_handle,
+				 state->backend_image_spec,
+				 &state->backend_handle);
+		if (result != 0) {
+			WARN("Failed to open Firmware Image Package (%i)\n",
+			     result);
+			state->backend_handle = (uintptr_t)NULL;
+			free_file_state(fp);
+			return -ENOENT;
 		}
-	} while ((found_file == 0) &&
-			(compare_uuids(&current_fip_file.entry.uuid,
-				&uuid_null) != 0));
-
-	if (found_file == 1) {
-		/* All fine. Update entity info with file state and return. Set
-		 * the file position to 0. The 'current_fip_file.entry' holds
-		 * the base and size of the file.
-		 */
-		current_fip_file.file_pos = 0;
-		entity->info = (uintptr_t)&current_fip_file;
-	} else {
-		/* Did not find the file in the FIP. */
-		current_fip_file.entry.offset_address = 0;
-		result = -ENOENT;
 	}
+	state->open_files++;
 
- fip_file_open_close:
-	io_close(backend_handle);
+	/* All fine. Update entity info with file state and return. Set
+	 * the file position to 0. The 'entry' holds the base and size of
+	 * the file.
+	 */
+	fp->entry = *toc_entry;
+	fp->file_pos = 0;
+	entity->info = (uintptr_t)fp;
 
- fip_file_open_exit:
-	return result;
+	return 0;
 }
 
 
@@ -389,56 +543,62 @@ static int fip_file_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 	assert(length_read != NULL);
 	assert(entity->info != (uintptr_t)NULL);
 
-	/* Open the backend, attempt to access the blob image */
-	result = io_open(backend_dev_handle, backend_image_spec,
-			 &backend_handle);
-	if (result != 0) {
-		WARN("Failed to open FIP (%i)\n", result);
-		result = -ENOENT;
-		goto fip_file_read_exit;
+	fp = (fip_file_state_t *)entity->info;
+	if (fp->dev_state == NULL) {
+		/* The device was closed underneath this file */
+		return -ENOENT;
 	}
 
-	fp = (fip_file_state_t *)entity->info;
+	backend_handle = fp->dev_state->backend_handle;
+	assert(backend_handle != (uintptr_t)NULL);
 
-	/* Seek to the position in the FIP where the payload lives */
+	/*
+	 * Seek to the position in the FIP where the payload lives. The backend
+	 * handle is shared with the other files open on the device, so the
+	 * position has to be set on every read.
+	 */
 	file_offset = fp->entry.offset_address + fp->file_pos;
 	result = io_seek(backend_handle, IO_SEEK_SET,
 			 (signed long long)file_offset);
 	if (result != 0) {
 		WARN("fip_file_read: failed to seek\n");
-		result = -ENOENT;
-		goto fip_file_read_close;
+		return -ENOENT;
 	}
 
 	result = io_read(backend_handle, buffer, length, &bytes_read);
 	if (result != 0) {
 		/* We cannot read our data. Fail. */
 		WARN("Failed to read payload (%i)\n", result);
-		result = -ENOENT;
-		goto fip_file_read_close;
-	} else {
-		/* Set caller length and new file position. */
-		*length_read = bytes_read;
-		fp->file_pos += bytes_read;
+		return -ENOENT;
 	}
 
-/* Close the backend. */
- fip_file_read_close:
-	io_close(backend_handle);
+	/* Set caller length and new file position. */
+	*length_read = bytes_read;
+	fp->file_pos += bytes_read;
 
- fip_file_read_exit:
-	return result;
+	return 0;
 }
 
 
 /* Close a file in package */
 static int fip_file_close(io_entity_t *entity)
 {
-	/* Clear our current file pointer.
-	 * If we had malloc() we would free() here.
-	 */
-	if (current_fip_file.entry.offset_address != 0U) {
-		zeromem(&current_fip_file, sizeof(current_fip_file));
+	fip_file_state_t *fp;
+	fip_dev_state_t *state;
+
+	assert(entity != NULL);
+
+	fp = (fip_file_state_t *)entity->info;
+	if ((fp != NULL) && (fp->dev_state != NULL)) {
+		state = fp->dev_state;
+		assert(state->open_files > 0U);
+
+		/* The last file closed on the device releases the backend */
+		if (--state->open_files == 0U) {
+			close_backend(state);
+		}
+
+		free_file_state(fp);
 	}
 
 	/* Clear the Entity info. */
@@ -1,14 +1,16 @@
 /*
- * Copyright (c) 2014-2020, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2014-2024, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 #include <platform_def.h>
 
+#include <common/debug.h>
 #include <drivers/io/io_driver.h>
 #include <drivers/io/io_storage.h>
 
@@ -28,6 +30,27 @@ static const io_dev_info_t *devices[MAX_IO_DEVICES];
 /* Number of currently registered devices */
 static unsigned int dev_count;
 
+#if PERSISTENT_IO_DEVICES
+/*
+ * Devices opened with io_dev_open(), identified by their connector and
+ * specification. They stay open and initialised until io_dev_close_all(), and
+ * 'ref_count' tracks the io_dev_init() calls not yet matched by io_dev_close().
+ */
+typedef struct {
+	const io_dev_connector_t *dev_con;
+	uintptr_t dev_spec;
+	io_dev_info_t *dev_info;
+	uintptr_t init_params;
+	bool initialised;
+	unsigned int ref_count;
+} io_dev_cache_t;
+
+static io_dev_cache_t dev_cache[MAX_IO_DEVICES];
+
+/* Number of devices in the cache */
+static unsigned int dev_cache_count;
+#endif /* PERSISTENT_IO_DEVICES */
+
 /* Extra validation functions only used when asserts are enabled */
 #if ENABLE_ASSERTIONS
 
@@ -139,6 +162,34 @@ static int free_entity(const io_entity_t *entity)
 }
 
 
+#if PERSISTENT_IO_DEVICES
+/* Locate a device in the cache by connector and specification */
+static io_dev_cache_t *find_cached_dev_spec(const io_dev_connector_t *dev_con,
+					    const uintptr_t dev_spec)
+{
+	for (unsigned int index = 0; index < dev_cache_count; ++index) {
+		if ((dev_cache[index].dev_con == dev_con) &&
+		    (dev_cache[index].dev_spec == dev_spec)) {
+			return &dev_cache[index];
+		}
+	}
+	return NULL;
+}
+
+
+/* Locate a device in the cache by handle */
+static io_dev_cache_t *find_cached_dev(const io_dev_info_t *dev_info)
+{
+	for (unsigned int index = 0; index < dev_cache_count; ++index) {
+		if (dev_cache[index].dev_info == dev_info) {
+			return &dev_cache[index];
+		}
+	}
+	return NULL;
+}
+#endif /* PERSISTENT_IO_DEVICES */
+
+
 /* Exported API */
 
 /* Register a device driver */
@@ -162,7 +213,37 @@ int io_dev_open(const io_dev_connector_t *dev_con, const uintptr_t dev_spec,
 		uintptr_t *handle)
 {
 	assert(handle != NULL);
+#if PERSISTENT_IO_DEVICES
+	int result;
+	io_dev_info_t *dev_info;
+	io_dev_cache_t *cached = find_cached_dev_spec(dev_con, dev_spec);
+
+	/* Reuse the connection if the device is already open */
+	if (cached != NULL) {
+		*handle = (uintptr_t)cached->dev_info;
+		return 0;
+	}
+
+	result = io_storage_dev_open(dev_con, dev_spec, &dev_info);
+	if (result == 0) {
+		/* A device that does not fit in the cache is not kept open */
+		if (dev_cache_count < MAX_IO_DEVICES) {
+			cached = &dev_cache[dev_cache_count];
+			cached->dev_con = dev_con;
+			cached->dev_spec = dev_spec;
+			cached->dev_info = dev_info;
+			cached->init_params = 0;
+			cached->initialised = false;
+			cached->ref_count = 0U;
+			dev_cache_count++;
+		}
+		*handle = (uintptr_t)dev_info;
+	}
+
+	return result;
+#else
 	return io_storage_dev_open(dev_con, dev_spec, (io_dev_info_t **)handle);
+#endif /* PERSISTENT_IO_DEVICES */
 }
 
 
@@ -176,11 +257,41 @@ int io_dev_init(uintptr_t dev_handle, const uintptr_t init_params)
 
 	io_dev_info_t *dev = (io_dev_info_t *)dev_handle;
 
+#if PERSISTENT_IO_DEVICES
+	io_dev_cache_t *cached = find_cached_dev(dev);
+
+	if ((cached != NULL) && cached->initialised) {
+		if (cached->init_params == init_params) {
+			/* Already initialised, nothing to do */
+			cached->ref_count++;
+			return 0;
+		}
+
+		/*
+		 * Re-initialised with other parameters: close the device first
+		 * as it would have been without the cache, unless it is in use.
+		 */
+		if ((cached->ref_count == 0U) &&
+		    (dev->funcs->dev_close != NULL)) {
+			(void)dev->funcs->dev_close(dev);
+		}
+		cached->initialised = false;
+	}
+#endif /* PERSISTENT_IO_DEVICES */
+
 	/* Absence of registered function implies NOP here */
 	if (dev->funcs->dev_init != NULL) {
 		result = dev->funcs->dev_init(dev, init_params);
 	}
 
+#if PERSISTENT_IO_DEVICES
+	if ((cached != NULL) && (result == 0)) {
+		cached->init_params = init_params;
+		cached->initialised = true;
+		cached->ref_count++;
+	}
+#endif /* PERSISTENT_IO_DEVICES */
+
 	return result;
 }
 
@@ -193,6 +304,18 @@ int io_dev_close(uintptr_t dev_handle)
 
 	io_dev_info_t *dev = (io_dev_info_t *)dev_handle;
 
+#if PERSISTENT_IO_DEVICES
+	io_dev_cache_t *cached = find_cached_dev(dev);
+
+	/* Keep the device open until io_dev_close_all() */
+	if (cached != NULL) {
+		if (cached->ref_count != 0U) {
+			cached->ref_count--;
+		}
+		return 0;
+	}
+#endif /* PERSISTENT_IO_DEVICES */
+
 	/* Absence of registered function implies NOP here */
 	if (dev->funcs->dev_close != NULL) {
 		result = dev->funcs->dev_close(dev);
@@ -201,6 +324,40 @@ int io_dev_close(uintptr_t dev_handle)
 	return result;
 }
 
+#if PERSISTENT_IO_DEVICES
+/*
+ * Close all the devices kept open, at the end of the boot stage. They are
+ * closed in the reverse order of opening, so that a device is closed before
+ * the devices it was set up on.
+ */
+int io_dev_close_all(void)
+{
+	int result = 0;
+	int close_result;
+	io_dev_info_t *dev;
+
+	while (dev_cache_count != 0U) {
+		dev_cache_count--;
+		dev = dev_cache[dev_cache_count].dev_info;
+
+		if (dev_cache[dev_cache_count].ref_count != 0U) {
+			VERBOSE("IO device closed with %u references\n",
+				dev_cache[dev_cache_count].ref_count);
+		}
+
+		/* Absence of registered function implies NOP here */
+		if (dev->funcs->dev_close != NULL) {
+			close_result = dev->funcs->dev_close(dev);
+			if (result == 0) {
+				result = close_result;
+			}
+		}
+	}
+
+	return result;
+}
+#endif /* PERSISTENT_IO_DEVICES */
+
 
 /* Synchronous operations */
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2022, Arm Limited. All rights reserved.
+ * Copyright (c) 2020-2024, Arm Limited. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -24,6 +24,27 @@
 #  error Invalid TPM algorithm.
 #endif /* TPM_ALG_ID */
 
+/* PCR bank of the Event Log */
+typedef struct event_log_bank {
+	uint16_t algorithm_id;
+	uint16_t digest_size;
+	enum crypto_md_algo md_alg;
+} event_log_bank_t;
+
+/* PCR banks recorded in each event, the one of TPM_ALG_ID first */
+static const event_log_bank_t event_log_banks[HASH_ALG_COUNT] = {
+	{ TPM_ALG_ID, TCG_DIGEST_SIZE, CRYPTO_MD_ID },
+#if EVENT_LOG_EXTRA_SHA256
+	{ TPM_ALG_SHA256, SHA256_DIGEST_SIZE, CRYPTO_MD_SHA256 },
+#endif
+#if EVENT_LOG_EXTRA_SHA384
+	{ TPM_ALG_SHA384, SHA384_DIGEST_SIZE, CRYPTO_MD_SHA384 },
+#endif
+#if EVENT_LOG_EXTRA_SHA512
+	{ TPM_ALG_SHA512, SHA512_DIGEST_SIZE, CRYPTO_MD_SHA512 },
+#endif
+};
+
 /* Running Event Log Pointer */
 static uint8_t *log_ptr;
 
@@ -78,7 +99,8 @@ static const event2_header_t locality_event_header = {
 /*
  * Record a measurement as a TCG_PCR_EVENT2 event
  *
- * @param[in] hash		Pointer to hash data of TCG_DIGEST_SIZE bytes
+ * @param[in] hash		Pointer to the digests of all the PCR banks, back
+ * 				to back, EVENT_LOG_HASH_SIZE bytes in total
  * @param[in] event_type	Type of Event, Various Event Types are
  * 				mentioned in tcg.h header
  * @param[in] metadata_ptr	Pointer to event_log_metadata_t structure
@@ -90,6 +112,7 @@ void event_log_record(const uint8_t *hash, uint32_t event_type,
 {
 	void *ptr = log_ptr;
 	uint32_t name_len = 0U;
+	unsigned int i;
 
 	assert(hash != NULL);
 	assert(metadata_ptr != NULL);
@@ -123,17 +146,22 @@ void event_log_record(const uint8_t *hash, uint32_t event_type,
 	ptr = (uint8_t *)((uintptr_t)ptr +
 			offsetof(tpml_digest_values, digests));
 
-	/* TCG_PCR_EVENT2.Digests[].AlgorithmId */
-	((tpmt_ha *)ptr)->algorithm_id = TPM_ALG_ID;
+	for (i = 0U; i < HASH_ALG_COUNT; i++) {
+		/* TCG_PCR_EVENT2.Digests[].AlgorithmId */
+		((tpmt_ha *)ptr)->algorithm_id = event_log_banks[i].algorithm_id;
 
-	/* TCG_PCR_EVENT2.Digests[].Digest[] */
-	ptr = (uint8_t *)((uintptr_t)ptr + offsetof(tpmt_ha, digest));
+		/* TCG_PCR_EVENT2.Digests[].Digest[] */
+		ptr = (uint8_t *)((uintptr_t)ptr + offsetof(tpmt_ha, digest));
 
-	/* Copy digest */
-	(void)memcpy(ptr, (const void *)hash, TCG_DIGEST_SIZE);
+		/* Copy digest */
+		(void)memcpy(ptr, (const void *)hash,
+			     event_log_banks[i].digest_size);
+		hash += event_log_banks[i].digest_size;
+		ptr = (uint8_t *)((uintptr_t)ptr +
+				  event_log_banks[i].digest_size);
+	}
 
 	/* TCG_PCR_EVENT2.EventSize */
-	ptr = (uint8_t *)((uintptr_t)ptr + TCG_DIGEST_SIZE);
 	((event2_data_t *)ptr)->event_size = name_len;
 
 	/* Copy event data to TCG_PCR_EVENT2.Event */
@@ -154,6 +182,9 @@ void event_log_buf_init(uint8_t *event_log_start, uint8_t *event_log_finish)
 
 	log_ptr = event_log_start;
 	log_end = (uintptr_t)event_log_finish;
+
+	/* Reuse the hashes calculated to authenticate the measured images */
+	crypto_mod_set_kept_hash_alg(CRYPTO_MD_ID);
 }
 
 /*
@@ -173,6 +204,7 @@ void event_log_init(uint8_t *event_log_start, uint8_t *event_log_finish)
 void event_log_write_specid_event(void)
 {
 	void *ptr = log_ptr;
+	unsigned int i;
 
 	/* event_log_buf_init() must have been called prior to this. */
 	assert(log_ptr != NULL);
@@ -187,10 +219,15 @@ void event_log_write_specid_event(void)
 			sizeof(id_event_header));
 	ptr = (uint8_t *)((uintptr_t)ptr + sizeof(id_event_header));
 
-	/* TCG_EfiSpecIdEventAlgorithmSize structure */
-	((id_event_algorithm_size_t *)ptr)->algorithm_id = TPM_ALG_ID;
-	((id_event_algorithm_size_t *)ptr)->digest_size = TCG_DIGEST_SIZE;
-	ptr = (uint8_t *)((uintptr_t)ptr + sizeof(id_event_algorithm_size_t));
+	/* TCG_EfiSpecIdEventAlgorithmSize structure, one per PCR bank */
+	for (i = 0U; i < HASH_ALG_COUNT; i++) {
+		((id_event_algorithm_size_t *)ptr)->algorithm_id =
+			event_log_banks[i].algorithm_id;
+		((id_event_algorithm_size_t *)ptr)->digest_size =
+			event_log_banks[i].digest_size;
+		ptr = (uint8_t *)((uintptr_t)ptr +
+				  sizeof(id_event_algorithm_size_t));
+	}
 
 	/*
 	 * TCG_EfiSpecIDEventStruct.vendorInfoSize
@@ -209,6 +246,7 @@ void event_log_write_header(void)
 {
 	const char locality_signature[] = TCG_STARTUP_LOCALITY_SIGNATURE;
 	void *ptr;
+	unsigned int i;
 
 	event_log_write_specid_event();
 
@@ -227,13 +265,16 @@ void event_log_write_header(void)
 			sizeof(locality_event_header));
 	ptr = (uint8_t *)((uintptr_t)ptr + sizeof(locality_event_header));
 
-	/* TCG_PCR_EVENT2.Digests[].AlgorithmId */
-	((tpmt_ha *)ptr)->algorithm_id = TPM_ALG_ID;
+	for (i = 0U; i < HASH_ALG_COUNT; i++) {
+		/* TCG_PCR_EVENT2.Digests[].AlgorithmId */
+		((tpmt_ha *)ptr)->algorithm_id = event_log_banks[i].algorithm_id;
 
-	/* TCG_PCR_EVENT2.Digests[].Digest[] */
-	(void)memset(&((tpmt_ha *)ptr)->digest, 0, TCG_DIGEST_SIZE);
-	ptr = (uint8_t *)((uintptr_t)ptr +
-			offsetof(tpmt_ha, digest) + TCG_DIGEST_SIZE);
+		/* TCG_PCR_EVENT2.Digests[].Digest[] */
+		(void)memset(&((tpmt_ha *)ptr)->digest, 0,
+			     event_log_banks[i].digest_size);
+		ptr = (uint8_t *)((uintptr_t)ptr + offsetof(tpmt_ha, digest) +
+				  event_log_banks[i].digest_size);
+	}
 
 	/* TCG_PCR_EVENT2.EventSize */
 	((event2_data_t *)ptr)->event_size =
@@ -252,12 +293,36 @@ void event_log_write_header(void)
 	log_ptr = (uint8_t *)((uintptr_t)ptr + sizeof(startup_locality_event_t));
 }
 
+/*
+ * Calculate the digests of data for all the PCR banks, in a single pass over
+ * the data when the crypto library supports it.
+ *
+ * @param[in]  data_base	Address of data
+ * @param[in]  data_size	Size of data
+ * @param[out] hash_data	Digests, back to back in the order of the banks
+ * @return:
+ *	0 = success
+ *    < 0 = error
+ */
 int event_log_measure(uintptr_t data_base, uint32_t data_size,
-		      unsigned char hash_data[CRYPTO_MD_MAX_SIZE])
+		      unsigned char hash_data[EVENT_LOG_HASH_BUF_SIZE])
 {
+#if HASH_ALG_COUNT > 1
+	enum crypto_md_algo md_algs[HASH_ALG_COUNT];
+	unsigned int i;
+
+	for (i = 0U; i < HASH_ALG_COUNT; i++) {
+		md_algs[i] = event_log_banks[i].md_alg;
+	}
+
+	return crypto_mod_calc_hash_multi(md_algs, HASH_ALG_COUNT,
+					  (void *)data_base, data_size,
+					  hash_data);
+#else
 	/* Calculate hash */
 	return crypto_mod_calc_hash(CRYPTO_MD_ID,
 				    (void *)data_base, data_size, hash_data);
+#endif
 }
 
 /*
@@ -276,7 +341,7 @@ int event_log_measure_and_record(uintptr_t data_base, uint32_t data_size,
 				 uint32_t data_id,
 				 const event_log_metadata_t *metadata_ptr)
 {
-	unsigned char hash_data[CRYPTO_MD_MAX_SIZE];
+	unsigned char hash_data[EVENT_LOG_HASH_BUF_SIZE];
 	int rc;
 
 	assert(metadata_ptr != NULL);
@@ -1,5 +1,5 @@
 #
-# Copyright (c) 2020-2022, Arm Limited. All rights reserved.
+# Copyright (c) 2020-2024, Arm Limited. All rights reserved.
 #
 # SPDX-License-Identifier: BSD-3-Clause
 #
@@ -27,12 +27,36 @@ else
     TCG_DIGEST_SIZE		:=	32U
 endif #MBOOT_EL_HASH_ALG
 
+# Additional PCR banks recorded in the Event Log, as a space-separated list of
+# sha256, sha384 and sha512. Each event then holds one digest per bank, all
+# calculated in a single pass over the measured data.
+MBOOT_EL_EXTRA_HASH_ALGS	?=
+
+MBOOT_EL_EXTRA_HASH_ALGS	:=	$(filter-out ${MBOOT_EL_HASH_ALG}, \
+					$(sort ${MBOOT_EL_EXTRA_HASH_ALGS}))
+
+ifneq ($(filter-out sha256 sha384 sha512,${MBOOT_EL_EXTRA_HASH_ALGS}),)
+    $(error "MBOOT_EL_EXTRA_HASH_ALGS can only hold sha256, sha384 and sha512")
+endif
+
+EVENT_LOG_EXTRA_SHA256	:=	$(if $(filter sha256,${MBOOT_EL_EXTRA_HASH_ALGS}),1,0)
+EVENT_LOG_EXTRA_SHA384	:=	$(if $(filter sha384,${MBOOT_EL_EXTRA_HASH_ALGS}),1,0)
+EVENT_LOG_EXTRA_SHA512	:=	$(if $(filter sha512,${MBOOT_EL_EXTRA_HASH_ALGS}),1,0)
+
+# The crypto library must support SHA-384 and SHA-512 for these banks.
+ifneq ($(filter sha384 sha512,${MBOOT_EL_EXTRA_HASH_ALGS}),)
+    $(eval $(call add_define,TF_MBEDTLS_MBOOT_USE_SHA512))
+endif
+
 # Set definitions for Measured Boot driver.
 $(eval $(call add_defines,\
     $(sort \
         TPM_ALG_ID \
         TCG_DIGEST_SIZE \
         EVENT_LOG_LEVEL \
+        EVENT_LOG_EXTRA_SHA256 \
+        EVENT_LOG_EXTRA_SHA384 \
+        EVENT_LOG_EXTRA_SHA512 \
 )))
 
 EVENT_LOG_SRC_DIR	:= drivers/measured_boot/event_log/
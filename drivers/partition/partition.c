@@ -6,6 +6,7 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -16,10 +17,41 @@
 #include <drivers/partition/partition.h>
 #include <drivers/partition/gpt.h>
 #include <drivers/partition/mbr.h>
+#include <lib/utils.h>
+#include <lib/utils_def.h>
 #include <plat/common/platform.h>
 
-static uint8_t mbr_sector[PLAT_PARTITION_BLOCK_SIZE];
+#define GPT_ENTRIES_PER_READ	\
+	((unsigned int)(PLAT_PARTITION_READ_SIZE / sizeof(gpt_entry_t)))
+
+/*
+ * Lookup tables of the partition entries by name, type GUID and unique GUID.
+ * They are open addressing hash tables that hold the index of the entry in
+ * the list plus one, or zero for an empty slot. Keeping them at most half
+ * full makes sure a lookup always finds an empty slot.
+ */
+#define PARTITION_INDEX_SIZE	256U
+
+CASSERT((PLAT_PARTITION_READ_SIZE % sizeof(gpt_entry_t)) == 0U,
+	assert_plat_partition_read_size_entries);
+CASSERT((PLAT_PARTITION_MAX_ENTRIES * 2) <= PARTITION_INDEX_SIZE,
+	assert_partition_index_size);
+
+/*
+ * The MBR sector and the chunks of the GPT entry array are never needed at
+ * the same time, so they share a buffer. With the default
+ * PLAT_PARTITION_READ_SIZE, reading the entries takes no extra memory.
+ */
+static union {
+	uint8_t mbr_sector[PLAT_PARTITION_BLOCK_SIZE];
+	gpt_entry_t gpt_entries[GPT_ENTRIES_PER_READ];
+} part_buf;
 static partition_entry_list_t list;
+static uint8_t name_index[PARTITION_INDEX_SIZE];
+static uint8_t type_guid_index[PARTITION_INDEX_SIZE];
+static uint8_t part_guid_index[PARTITION_INDEX_SIZE];
+
+typedef bool (*entry_match_t)(const partition_entry_t *entry, const void *key);
 
 #if LOG_LEVEL >= LOG_LEVEL_VERBOSE
 static void dump_entries(int num)
@@ -59,7 +91,7 @@ static int load_mbr_header(uintptr_t image_handle, mbr_entry_t *mbr_entry)
 		VERBOSE("Failed to seek (%i)\n", result);
 		return result;
 	}
-	result = io_read(image_handle, (uintptr_t)&mbr_sector,
+	result = io_read(image_handle, (uintptr_t)&part_buf.mbr_sector,
 			 PLAT_PARTITION_BLOCK_SIZE, &bytes_read);
 	if ((result != 0) || (bytes_read != PLAT_PARTITION_BLOCK_SIZE)) {
 		VERBOSE("Failed to read data (%i)\n", result);
@@ -67,13 +99,15 @@ static int load_mbr_header(uintptr_t image_handle, mbr_entry_t *mbr_entry)
 	}
 
 	/* Check MBR boot signature. */
-	if ((mbr_sector[LEGACY_PARTITION_BLOCK_SIZE - 2] != MBR_SIGNATURE_FIRST) ||
-	    (mbr_sector[LEGACY_PARTITION_BLOCK_SIZE - 1] != MBR_SIGNATURE_SECOND)) {
+	if ((part_buf.mbr_sector[LEGACY_PARTITION_BLOCK_SIZE - 2] !=
+	     MBR_SIGNATURE_FIRST) ||
+	    (part_buf.mbr_sector[LEGACY_PARTITION_BLOCK_SIZE - 1] !=
+	     MBR_SIGNATURE_SECOND)) {
 		VERBOSE("MBR boot signature failure\n");
 		return -ENOENT;
 	}
 
-	tmp = (mbr_entry_t *)(&mbr_sector[MBR_PRIMARY_ENTRY_OFFSET]);
+	tmp = (mbr_entry_t *)(&part_buf.mbr_sector[MBR_PRIMARY_ENTRY_OFFSET]);
 
 	if (tmp->first_lba != 1) {
 		VERBOSE("MBR header may have an invalid first LBA\n");
@@ -163,7 +197,7 @@ static int load_mbr_entry(uintptr_t image_handle, mbr_entry_t *mbr_entry,
 		VERBOSE("Failed to seek (%i)\n", result);
 		return result;
 	}
-	result = io_read(image_handle, (uintptr_t)&mbr_sector,
+	result = io_read(image_handle, (uintptr_t)&part_buf.mbr_sector,
 			 PLAT_PARTITION_BLOCK_SIZE, &bytes_read);
 	if (result != 0) {
 		VERBOSE("Failed to read data (%i)\n", result);
@@ -171,12 +205,14 @@ static int load_mbr_entry(uintptr_t image_handle, mbr_entry_t *mbr_entry,
 	}
 
 	/* Check MBR boot signature. */
-	if ((mbr_sector[LEGACY_PARTITION_BLOCK_SIZE - 2] != MBR_SIGNATURE_FIRST) ||
-	    (mbr_sector[LEGACY_PARTITION_BLOCK_SIZE - 1] != MBR_SIGNATURE_SECOND)) {
+	if ((part_buf.mbr_sector[LEGACY_PARTITION_BLOCK_SIZE - 2] !=
+	     MBR_SIGNATURE_FIRST) ||
+	    (part_buf.mbr_sector[LEGACY_PARTITION_BLOCK_SIZE - 1] !=
+	     MBR_SIGNATURE_SECOND)) {
 		VERBOSE("MBR Entry boot signature failure\n");
 		return -ENOENT;
 	}
-	offset = (uintptr_t)&mbr_sector +
+	offset = (uintptr_t)&part_buf.mbr_sector +
 		MBR_PRIMARY_ENTRY_OFFSET +
 		MBR_PRIMARY_ENTRY_SIZE * part_number;
 	memcpy(mbr_entry, (void *)offset, sizeof(mbr_entry_t));
@@ -184,6 +220,95 @@ static int load_mbr_entry(uintptr_t image_handle, mbr_entry_t *mbr_entry,
 	return 0;
 }
 
+/*
+ * Return the first slot of a lookup table to probe for a key (FNV-1a hash).
+ */
+static unsigned int index_hash(const void *key, size_t length)
+{
+	const uint8_t *data = key;
+	uint32_t hash = 2166136261U;
+	size_t i;
+
+	for (i = 0U; i < length; i++) {
+		hash ^= data[i];
+		hash *= 16777619U;
+	}
+
+	return hash & (PARTITION_INDEX_SIZE - 1U);
+}
+
+static void index_add(uint8_t *index, unsigned int slot, unsigned int entry)
+{
+	while (index[slot] != 0U) {
+		slot = (slot + 1U) & (PARTITION_INDEX_SIZE - 1U);
+	}
+	index[slot] = (uint8_t)(entry + 1U);
+}
+
+/*
+ * Probe a lookup table from 'slot' for an entry matching 'key'. Entries with
+ * the same key are found in list order.
+ */
+static const partition_entry_t *index_find(const uint8_t *index,
+					   unsigned int slot,
+					   entry_match_t match,
+					   const void *key)
+{
+	const partition_entry_t *entry;
+	unsigned int i;
+
+	for (i = 0U; (i < PARTITION_INDEX_SIZE) && (index[slot] != 0U); i++) {
+		entry = &list.list[index[slot] - 1U];
+		if (match(entry, key)) {
+			return entry;
+		}
+		slot = (slot + 1U) & (PARTITION_INDEX_SIZE - 1U);
+	}
+
+	return NULL;
+}
+
+static bool match_name(const partition_entry_t *entry, const void *key)
+{
+	return strcmp(key, entry->name) == 0;
+}
+
+static bool match_type_guid(const partition_entry_t *entry, const void *key)
+{
+	return guidcmp(key, &entry->type_guid) == 0;
+}
+
+static bool match_part_guid(const partition_entry_t *entry, const void *key)
+{
+	return guidcmp(key, &entry->part_guid) == 0;
+}
+
+/*
+ * Rebuild the lookup tables from the list of partition table entries.
+ */
+static void build_partition_index(void)
+{
+	const partition_entry_t *entry;
+	unsigned int i;
+
+	zeromem(name_index, sizeof(name_index));
+	zeromem(type_guid_index, sizeof(type_guid_index));
+	zeromem(part_guid_index, sizeof(part_guid_index));
+
+	for (i = 0U; i < list.entry_count; i++) {
+		entry = &list.list[i];
+		index_add(name_index,
+			  index_hash(entry->name,
+				     strnlen(entry->name, EFI_NAMELEN)), i);
+		index_add(type_guid_index,
+			  index_hash(&entry->type_guid,
+				     sizeof(struct efi_guid)), i);
+		index_add(part_guid_index,
+			  index_hash(&entry->part_guid,
+				     sizeof(struct efi_guid)), i);
+	}
+}
+
 /*
  * Load MBR entries based on max number of partition entries.
  */
@@ -205,20 +330,22 @@ static int load_mbr_entries(uintptr_t image_handle)
 }
 
 /*
- * Try to read and load a single GPT entry.
+ * Read the next 'count' GPT entries of the partition entry array into
+ * the GPT entry buffer with a single read.
  */
-static int load_gpt_entry(uintptr_t image_handle, gpt_entry_t *entry)
+static int load_gpt_entries(uintptr_t image_handle, unsigned int count)
 {
 	size_t bytes_read = 0U;
+	size_t length = count * sizeof(gpt_entry_t);
 	int result;
 
-	assert(entry != NULL);
-	result = io_read(image_handle, (uintptr_t)entry, sizeof(gpt_entry_t),
-			&bytes_read);
-	if ((result != 0) || (sizeof(gpt_entry_t) != bytes_read)) {
+	assert(count <= GPT_ENTRIES_PER_READ);
+	result = io_read(image_handle, (uintptr_t)part_buf.gpt_entries, length,
+			 &bytes_read);
+	if ((result != 0) || (length != bytes_read)) {
 		VERBOSE("GPT Entry read error(%i) or read mismatch occurred,"
 			"expected(%zu) and actual(%zu)\n", result,
-			sizeof(gpt_entry_t), bytes_read);
+			length, bytes_read);
 		return -EINVAL;
 	}
 
@@ -226,15 +353,20 @@ static int load_gpt_entry(uintptr_t image_handle, gpt_entry_t *entry)
 }
 
 /*
- * Retrieve each entry in the partition table, parse the data from each
- * entry and store them in the list of partition table entries.
+ * Retrieve the partition table in chunks of up to GPT_ENTRIES_PER_READ
+ * entries, parse the data from each entry and store them in the list of
+ * partition table entries. No chunk reads past the end of the region
+ * mapped by image_handle.
  */
 static int load_partition_gpt(uintptr_t image_handle, gpt_header_t header)
 {
 	const signed long long gpt_entry_offset = LBA(header.part_lba);
-	gpt_entry_t entry;
+	size_t offset = (size_t)gpt_entry_offset;
+	size_t region_length, region_entries;
 	int result;
-	unsigned int i;
+	unsigned int i, j, count;
+	unsigned int valid_count = 0U;
+	bool parsing = true;
 	uint32_t calc_crc = 0U;
 
 	result = io_seek(image_handle, IO_SEEK_SET, gpt_entry_offset);
@@ -244,60 +376,74 @@ static int load_partition_gpt(uintptr_t image_handle, gpt_header_t header)
 		return result;
 	}
 
-	for (i = 0U; i < list.entry_count; i++) {
-		result = load_gpt_entry(image_handle, &entry);
+	/*
+	 * If the device cannot tell the size of the region, assume it ends
+	 * here so that the entries are read one at a time.
+	 */
+	if (io_size(image_handle, &region_length) != 0) {
+		region_length = 0U;
+	}
+
+	/*
+	 * Read the whole partition entry array, as the partition CRC from
+	 * the header covers all the entries, including the invalid ones.
+	 */
+	for (i = 0U; i < header.list_num; i += count) {
+		count = MIN(header.list_num - i, GPT_ENTRIES_PER_READ);
+
+		/*
+		 * Platforms may only map the entries they parse, while the
+		 * CRC covers the whole array. Past the end of the region, the
+		 * entries are read one at a time as they always have been.
+		 */
+		region_entries = 0U;
+		if (region_length > offset) {
+			region_entries = (region_length - offset) /
+					 sizeof(gpt_entry_t);
+		}
+		if (region_entries < count) {
+			count = (region_entries == 0U) ? 1U :
+				(unsigned int)region_entries;
+		}
+
+		result = load_gpt_entries(image_handle, count);
 		if (result != 0) {
 			VERBOSE("Failed to load gpt entry data(%u) error is (%i)\n",
 				i, result);
 			return result;
 		}
 
-		result = parse_gpt_entry(&entry, &list.list[i]);
-		if (result != 0) {
-			result = io_seek(image_handle, IO_SEEK_SET,
-					(gpt_entry_offset + (i * sizeof(gpt_entry_t))));
-			if (result != 0) {
-				VERBOSE("Failed to seek (%i)\n", result);
-				return result;
+		/*
+		 * Only records the valid partition entries up to the first
+		 * invalid one.
+		 */
+		for (j = 0U; parsing && (j < count); j++) {
+			if ((valid_count >= list.entry_count) ||
+			    (parse_gpt_entry(&part_buf.gpt_entries[j],
+					     &list.list[valid_count]) != 0)) {
+				parsing = false;
+			} else {
+				valid_count++;
 			}
-			break;
 		}
 
 		/*
 		 * Calculate CRC of Partition entry array to compare with CRC
 		 * value in header
 		 */
-		calc_crc = tf_crc32(calc_crc, (uint8_t *)&entry, sizeof(gpt_entry_t));
+		calc_crc = tf_crc32(calc_crc, (uint8_t *)part_buf.gpt_entries,
+				    count * sizeof(gpt_entry_t));
+		offset += count * sizeof(gpt_entry_t);
 	}
-	if (i == 0) {
+
+	if (valid_count == 0U) {
 		VERBOSE("No Valid GPT Entries found\n");
 		return -EINVAL;
 	}
 
-	/*
-	 * Only records the valid partition number that is loaded from
-	 * partition table.
-	 */
-	list.entry_count = i;
+	list.entry_count = valid_count;
 	dump_entries(list.entry_count);
 
-	/*
-	 * If there are less valid entries than the possible number of entries
-	 * from the header, continue to load the partition entry table to
-	 * calculate the full CRC in order to check against the partition CRC
-	 * from the header for validation.
-	 */
-	for (; i < header.list_num; i++) {
-		result = load_gpt_entry(image_handle, &entry);
-		if (result != 0) {
-			VERBOSE("Failed to load gpt entry data(%u) error is (%i)\n",
-				i, result);
-			return result;
-		}
-
-		calc_crc = tf_crc32(calc_crc, (uint8_t *)&entry, sizeof(gpt_entry_t));
-	}
-
 	if (header.part_crc != calc_crc) {
 		ERROR("Invalid GPT Partition Array Entry CRC: Expected 0x%x"
 				" but got 0x%x.\n", header.part_crc, calc_crc);
@@ -424,8 +570,10 @@ int load_partition_table(unsigned int image_id)
 		result = load_primary_gpt(image_handle, mbr_entry.first_lba);
 		if (result != 0) {
 			io_close(image_handle);
-			return load_backup_gpt(BKUP_GPT_IMAGE_ID,
-					       mbr_entry.sector_nums);
+			result = load_backup_gpt(BKUP_GPT_IMAGE_ID,
+						 mbr_entry.sector_nums);
+			build_partition_index();
+			return result;
 		}
 	} else {
 		result = load_mbr_entries(image_handle);
@@ -433,6 +581,7 @@ int load_partition_table(unsigned int image_id)
 
 out:
 	io_close(image_handle);
+	build_partition_index();
 	return result;
 }
 
@@ -441,14 +590,8 @@ out:
  */
 const partition_entry_t *get_partition_entry(const char *name)
 {
-	unsigned int i;
-
-	for (i = 0U; i < list.entry_count; i++) {
-		if (strcmp(name, list.list[i].name) == 0) {
-			return &list.list[i];
-		}
-	}
-	return NULL;
+	return index_find(name_index, index_hash(name, strlen(name)),
+			  match_name, name);
 }
 
 /*
@@ -457,15 +600,9 @@ const partition_entry_t *get_partition_entry(const char *name)
 const partition_entry_t *get_partition_entry_by_type(
 	const struct efi_guid *type_guid)
 {
-	unsigned int i;
-
-	for (i = 0U; i < list.entry_count; i++) {
-		if (guidcmp(type_guid, &list.list[i].type_guid) == 0) {
-			return &list.list[i];
-		}
-	}
-
-	return NULL;
+	return index_find(type_guid_index,
+			  index_hash(type_guid, sizeof(struct efi_guid)),
+			  match_type_guid, type_guid);
 }
 
 /*
@@ -474,15 +611,9 @@ const partition_entry_t *get_partition_entry_by_type(
 const partition_entry_t *get_partition_entry_by_guid(
 	const struct efi_guid *part_guid)
 {
-	unsigned int i;
-
-	for (i = 0U; i < list.entry_count; i++) {
-		if (guidcmp(part_guid, &list.list[i].part_guid) == 0) {
-			return &list.list[i];
-		}
-	}
-
-	return NULL;
+	return index_find(part_guid_index,
+			  index_hash(part_guid, sizeof(struct efi_guid)),
+			  match_part_guid, part_guid);
 }
 
 /*
@@ -280,6 +280,10 @@
 #define ID_AA64ISAR0_RNDR_SHIFT	U(60)
 #define ID_AA64ISAR0_RNDR_MASK	ULL(0xf)
 
+#define ID_AA64ISAR0_TLB_SHIFT		U(56)
+#define ID_AA64ISAR0_TLB_MASK		ULL(0xf)
+#define TLB_RANGE_IMPLEMENTED		ULL(0x2)
+
 /* ID_AA64ISAR1_EL1 definitions */
 #define ID_AA64ISAR1_EL1		S3_0_C0_C6_1
 
@@ -1039,6 +1043,24 @@
 #define TLBI_ADDR_MASK		ULL(0x00000FFFFFFFFFFF)
 #define TLBI_ADDR(x)		(((x) >> TLBI_ADDR_SHIFT) & TLBI_ADDR_MASK)
 
+/*
+ * Operand of the range TLBI instructions of FEAT_TLBIRANGE. They invalidate
+ * (NUM + 1) * 2^(5 * SCALE + 1) pages of the given granule from BaseADDR.
+ */
+#define TLBI_RANGE_BADDR_SHIFT	U(0)
+#define TLBI_RANGE_BADDR_MASK	ULL(0x1FFFFFFFFF)
+#define TLBI_RANGE_NUM_SHIFT	U(39)
+#define TLBI_RANGE_NUM_MASK	ULL(0x1F)
+#define TLBI_RANGE_SCALE_SHIFT	U(44)
+#define TLBI_RANGE_SCALE_MASK	ULL(0x3)
+#define TLBI_RANGE_TG_SHIFT	U(46)
+#define TLBI_RANGE_TG_4K	ULL(0x1)
+
+#define TLBI_RANGE_MAX_NUM	U(32)
+#define TLBI_RANGE_MAX_SCALE	U(3)
+#define TLBI_RANGE_PAGES(num, scale)	\
+	((unsigned long)(num) << ((5U * (scale)) + 1U))
+
 /*******************************************************************************
  * Definitions of register offsets and fields in the CNTCTLBase Frame of the
  * system level implementation of the Generic Timer.
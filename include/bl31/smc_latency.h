@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2024, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SMC_LATENCY_H
+#define SMC_LATENCY_H
+
+#include <lib/smccc.h>
+#include <lib/utils_def.h>
+
+/*
+ * Number of latency buckets. Bucket n counts the SMCs that took between 2^n
+ * and 2^(n+1) - 1 counter ticks, the last bucket also counts anything slower.
+ */
+#define SMC_LATENCY_BUCKETS		U(20)
+
+/* Number of distinct function IDs tracked per CPU */
+#ifndef SMC_LATENCY_MAX_FIDS
+#define SMC_LATENCY_MAX_FIDS		U(16)
+#endif
+
+/*
+ * Local timestamp IDs of the PMF service. The SMC function ID to report on
+ * is passed in the PMF flags argument. SMC_LATENCY_DROPPED returns the number
+ * of SMCs that were not recorded because the table of the CPU was full.
+ */
+#define SMC_LATENCY_BUCKET(n)		(n)
+#define SMC_LATENCY_CALLS		SMC_LATENCY_BUCKETS
+#define SMC_LATENCY_TICKS		(SMC_LATENCY_BUCKETS + U(1))
+#define SMC_LATENCY_DROPPED		(SMC_LATENCY_BUCKETS + U(2))
+#define SMC_LATENCY_TOTAL_IDS		(SMC_LATENCY_BUCKETS + U(3))
+
+/*
+ * When set in the PMF flags argument, the statistics of all the function IDs
+ * with the same call type and OEN as the requested one are added together.
+ * This reuses the SVE hint bit, which is never part of a recorded ID.
+ */
+#define SMC_LATENCY_BY_OEN		(FUNCID_SVE_HINT_MASK << \
+					 FUNCID_SVE_HINT_SHIFT)
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+void smc_latency_record(uint32_t smc_fid);
+#endif /* __ASSEMBLER__ */
+
+#endif /* SMC_LATENCY_H */
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2022, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2013-2023, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -167,10 +167,26 @@ typedef struct meminfo {
 	size_t total_size;
 } meminfo_t;
 
+/*******************************************************************************
+ * Consumer of an image loaded in pipelined mode. Instead of being loaded at
+ * its base address, the image is read in chunks of up to 'chunk_size' bytes,
+ * alternately into two staging buffers that start at 'buf_base', and each
+ * chunk is passed to 'process' as soon as it has been read. 'start' is called
+ * before the first chunk of each load attempt.
+ ******************************************************************************/
+typedef struct image_load_pipeline {
+	uintptr_t buf_base;
+	size_t chunk_size;
+	int (*start)(void);
+	int (*process)(uintptr_t chunk_base, size_t chunk_size);
+} image_load_pipeline_t;
+
 /*******************************************************************************
  * Function & variable prototypes
  ******************************************************************************/
 int load_auth_image(unsigned int image_id, image_info_t *image_data);
+void load_image_set_pipeline(const image_info_t *image_data,
+			     const image_load_pipeline_t *pipeline);
 
 #if TRUSTED_BOARD_BOOT && defined(DYN_DISABLE_AUTH)
 /*
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2022, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2020-2024, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -157,8 +157,15 @@
  * will be zero. For this reason, the only two valid values for
  * __PERCPU_BAKERY_LOCK_SIZE__ are 0 or the platform defined value
  * PLAT_PERCPU_BAKERY_LOCK_SIZE.
+ *
+ * Ticket locks are not allocated per CPU, so nothing should be placed in
+ * .bakery_lock and PLAT_PERCPU_BAKERY_LOCK_SIZE is ignored.
  */
-#ifdef PLAT_PERCPU_BAKERY_LOCK_SIZE
+#if USE_BAKERY_TICKET_LOCK
+#define BAKERY_LOCK_SIZE_CHECK				\
+	ASSERT(__PERCPU_BAKERY_LOCK_SIZE__ == 0,	\
+	       "Per-cpu bakery lock data found with USE_BAKERY_TICKET_LOCK");
+#elif defined(PLAT_PERCPU_BAKERY_LOCK_SIZE)
 #define BAKERY_LOCK_SIZE_CHECK				\
 	ASSERT((__PERCPU_BAKERY_LOCK_SIZE__ == 0) ||	\
 	       (__PERCPU_BAKERY_LOCK_SIZE__ == PLAT_PERCPU_BAKERY_LOCK_SIZE), \
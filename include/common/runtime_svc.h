@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2019, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2013-2024, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -21,15 +21,22 @@
  * descriptor
  */
 #ifdef __aarch64__
-#define RT_SVC_SIZE_LOG2	U(5)
 #define RT_SVC_DESC_INIT	U(16)
 #define RT_SVC_DESC_HANDLE	U(24)
+#if ENABLE_SMC_LEAF_HANDLERS
+#define RT_SVC_DESC_LEAF	U(32)
+#define SIZEOF_RT_SVC_DESC	U(40)
+#else
+#define RT_SVC_SIZE_LOG2	U(5)
+#endif /* ENABLE_SMC_LEAF_HANDLERS */
 #else
 #define RT_SVC_SIZE_LOG2	U(4)
 #define RT_SVC_DESC_INIT	U(8)
 #define RT_SVC_DESC_HANDLE	U(12)
 #endif /* __aarch64__ */
+#ifdef RT_SVC_SIZE_LOG2
 #define SIZEOF_RT_SVC_DESC	(U(1) << RT_SVC_SIZE_LOG2)
+#endif
 
 
 /*
@@ -58,6 +65,18 @@ typedef uintptr_t (*rt_svc_handle_t)(uint32_t smc_fid,
 				  void *cookie,
 				  void *handle,
 				  u_register_t flags);
+
+/*
+ * A runtime service may also provide a leaf handler for its fast SMCs, with
+ * the same prototype. When BL31 is built with ENABLE_SMC_LEAF_HANDLERS, the
+ * leaf handler is called first, with only the registers that a C function may
+ * corrupt saved in the context. It must return 0 for any SMC that it does not
+ * handle, which is then passed to the main handler as usual.
+ *
+ * A leaf handler may only handle calls that do nothing but return values
+ * with the SMC_RETx() macros: they must not access any other part of the
+ * context, switch to another world or unmask interrupts.
+ */
 typedef struct rt_svc_desc {
 	uint8_t start_oen;
 	uint8_t end_oen;
@@ -65,11 +84,33 @@ typedef struct rt_svc_desc {
 	const char *name;
 	rt_svc_init_t init;
 	rt_svc_handle_t handle;
+#if ENABLE_SMC_LEAF_HANDLERS
+	rt_svc_handle_t leaf;
+#endif
 } rt_svc_desc_t;
 
 /*
- * Convenience macros to declare a service descriptor
+ * Convenience macros to declare a service descriptor. Without
+ * ENABLE_SMC_LEAF_HANDLERS, the leaf handler is ignored and need not be
+ * defined.
  */
+#if ENABLE_SMC_LEAF_HANDLERS
+#define DECLARE_RT_SVC_LEAF(_name, _start, _end, _type, _setup, _smch,	\
+			    _leaf)					\
+	static const rt_svc_desc_t __svc_desc_ ## _name			\
+		__section(".rt_svc_descs") __used = {			\
+			.start_oen = (_start),				\
+			.end_oen = (_end),				\
+			.call_type = (_type),				\
+			.name = #_name,					\
+			.init = (_setup),				\
+			.handle = (_smch),				\
+			.leaf = (_leaf)					\
+		}
+
+#define DECLARE_RT_SVC(_name, _start, _end, _type, _setup, _smch)	\
+	DECLARE_RT_SVC_LEAF(_name, _start, _end, _type, _setup, _smch, NULL)
+#else
 #define DECLARE_RT_SVC(_name, _start, _end, _type, _setup, _smch)	\
 	static const rt_svc_desc_t __svc_desc_ ## _name			\
 		__section(".rt_svc_descs") __used = {			\
@@ -81,6 +122,11 @@ typedef struct rt_svc_desc {
 			.handle = (_smch)				\
 		}
 
+#define DECLARE_RT_SVC_LEAF(_name, _start, _end, _type, _setup, _smch,	\
+			    _leaf)					\
+	DECLARE_RT_SVC(_name, _start, _end, _type, _setup, _smch)
+#endif /* ENABLE_SMC_LEAF_HANDLERS */
+
 /*
  * Compile time assertions related to the 'rt_svc_desc' structure to:
  * 1. ensure that the assembler and the compiler view of the size
@@ -88,7 +134,7 @@ typedef struct rt_svc_desc {
  * 2. ensure that the assembler and the compiler see the initialisation
  *    routine at the same offset.
  * 3. ensure that the assembler and the compiler see the handler
- *    routine at the same offset.
+ *    routines at the same offset.
  */
 CASSERT((sizeof(rt_svc_desc_t) == SIZEOF_RT_SVC_DESC),
 	assert_sizeof_rt_svc_desc_mismatch);
@@ -96,6 +142,10 @@ CASSERT(RT_SVC_DESC_INIT == __builtin_offsetof(rt_svc_desc_t, init),
 	assert_rt_svc_desc_init_offset_mismatch);
 CASSERT(RT_SVC_DESC_HANDLE == __builtin_offsetof(rt_svc_desc_t, handle),
 	assert_rt_svc_desc_handle_offset_mismatch);
+#if ENABLE_SMC_LEAF_HANDLERS
+CASSERT(RT_SVC_DESC_LEAF == __builtin_offsetof(rt_svc_desc_t, leaf),
+	assert_rt_svc_desc_leaf_offset_mismatch);
+#endif
 
 
 /*
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021, Arm Limited. All rights reserved.
+ * Copyright (c) 2021-2024, Arm Limited. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -10,7 +10,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
-/* compute CRC using Arm intrinsic function */
+/* compute CRC32, using the Arm CRC instructions when available */
 uint32_t tf_crc32(uint32_t crc, const unsigned char *buf, size_t size);
 
 #endif /* TF_CRC32_H */
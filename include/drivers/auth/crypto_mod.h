@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2015-2023, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -39,6 +39,9 @@ enum crypto_md_algo {
 /* Maximum size as per the known stronger hash algorithm i.e.SHA512 */
 #define CRYPTO_MD_MAX_SIZE		64U
 
+/* Number of message digest algorithms */
+#define CRYPTO_MD_MAX_COUNT		3U
+
 /*
  * Cryptographic library descriptor
  */
@@ -61,11 +64,53 @@ typedef struct crypto_lib_desc_s {
 	int (*verify_hash)(void *data_ptr, unsigned int data_len,
 			   void *digest_info_ptr, unsigned int digest_info_len);
 
+	/*
+	 * Verify a hash calculated incrementally (optional). init() selects
+	 * the algorithm from the digest info, update() is called for each
+	 * chunk of data and final() compares the result with the digest info.
+	 * Only one operation can be in progress at a time. Return one of the
+	 * 'enum crypto_ret_value' options
+	 */
+	int (*verify_hash_init)(void *digest_info_ptr,
+				unsigned int digest_info_len);
+	int (*verify_hash_update)(void *data_ptr, unsigned int data_len);
+	int (*verify_hash_final)(void *digest_info_ptr,
+				 unsigned int digest_info_len);
+
 	/* Calculate a hash. Return hash value */
 	int (*calc_hash)(enum crypto_md_algo md_alg, void *data_ptr,
 			 unsigned int data_len,
 			 unsigned char output[CRYPTO_MD_MAX_SIZE]);
 
+	/*
+	 * Calculate a hash incrementally (optional). init() selects the
+	 * algorithm, update() is called for each chunk of data and final()
+	 * returns the hash. Only one operation can be in progress at a time,
+	 * independently of an incremental verification. Return one of the
+	 * 'enum crypto_ret_value' options
+	 */
+	int (*calc_hash_init)(enum crypto_md_algo md_alg);
+	int (*calc_hash_update)(void *data_ptr, unsigned int data_len);
+	int (*calc_hash_final)(unsigned char output[CRYPTO_MD_MAX_SIZE]);
+
+	/*
+	 * Calculate the hashes of the same data with several algorithms, in a
+	 * single pass over the data (optional). The hashes are written back to
+	 * back to the output. Return one of the 'enum crypto_ret_value' options
+	 */
+	int (*calc_hash_multi)(const enum crypto_md_algo *md_algs,
+			       unsigned int count, void *data_ptr,
+			       unsigned int data_len, unsigned char *output);
+
+	/*
+	 * Get the algorithm and the hash held in a digest info (optional).
+	 * Return one of the 'enum crypto_ret_value' options
+	 */
+	int (*get_digest_info)(void *digest_info_ptr,
+			       unsigned int digest_info_len,
+			       enum crypto_md_algo *md_alg,
+			       unsigned char **digest_ptr);
+
 	/* Convert Public key (optional) */
 	int (*convert_pk)(void *full_pk_ptr, unsigned int full_pk_len,
 			  void **hashed_pk_ptr, unsigned int *hashed_pk_len);
@@ -98,6 +143,11 @@ int crypto_mod_verify_signature(void *data_ptr, unsigned int data_len,
 				void *pk_ptr, unsigned int pk_len);
 int crypto_mod_verify_hash(void *data_ptr, unsigned int data_len,
 			   void *digest_info_ptr, unsigned int digest_info_len);
+int crypto_mod_verify_hash_init(void *digest_info_ptr,
+				unsigned int digest_info_len);
+int crypto_mod_verify_hash_update(void *data_ptr, unsigned int data_len);
+int crypto_mod_verify_hash_final(void *digest_info_ptr,
+				 unsigned int digest_info_len);
 #endif /* (CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_ONLY) || \
 	  (CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC) */
 
@@ -112,9 +162,35 @@ int crypto_mod_auth_decrypt(enum crypto_dec_algo dec_algo, void *data_ptr,
 int crypto_mod_calc_hash(enum crypto_md_algo alg, void *data_ptr,
 			 unsigned int data_len,
 			 unsigned char output[CRYPTO_MD_MAX_SIZE]);
+int crypto_mod_calc_hash_multi(const enum crypto_md_algo *algs,
+			       unsigned int count, void *data_ptr,
+			       unsigned int data_len, unsigned char *output);
+unsigned int crypto_mod_md_size(enum crypto_md_algo alg);
 #endif /* (CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY) || \
 	  (CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC) */
 
+/*
+ * Reuse of the hashes calculated to verify data, to measure the same data. See
+ * crypto_mod_set_kept_hash_alg().
+ */
+#if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
+void crypto_mod_set_kept_hash_alg(enum crypto_md_algo alg);
+void crypto_mod_keep_hash(void *data_ptr, unsigned int data_len);
+void crypto_mod_drop_hash(void);
+#else
+static inline void crypto_mod_set_kept_hash_alg(enum crypto_md_algo alg)
+{
+}
+
+static inline void crypto_mod_keep_hash(void *data_ptr, unsigned int data_len)
+{
+}
+
+static inline void crypto_mod_drop_hash(void)
+{
+}
+#endif /* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
+
 int crypto_mod_convert_pk(void *full_pk_ptr, unsigned int full_pk_len,
 			  void **hashed_pk_ptr, unsigned int *hashed_pk_len);
 
@@ -131,6 +207,53 @@ int crypto_mod_convert_pk(void *full_pk_ptr, unsigned int full_pk_len,
 		.convert_pk = _convert_pk \
 	}
 
+/*
+ * Macro to register a cryptographic library that can also calculate the
+ * hashes of the same data with several algorithms in a single pass
+ */
+#define REGISTER_CRYPTO_LIB_HASH_MULTI(_name, _init, _verify_signature, \
+			    _verify_hash, _calc_hash, _auth_decrypt, \
+			    _convert_pk, _calc_hash_multi) \
+	const crypto_lib_desc_t crypto_lib_desc = { \
+		.name = _name, \
+		.init = _init, \
+		.verify_signature = _verify_signature, \
+		.verify_hash = _verify_hash, \
+		.calc_hash = _calc_hash, \
+		.calc_hash_multi = _calc_hash_multi, \
+		.auth_decrypt = _auth_decrypt, \
+		.convert_pk = _convert_pk \
+	}
+
+/*
+ * Macro to register a cryptographic library that can also verify and
+ * calculate a hash incrementally
+ */
+#define REGISTER_CRYPTO_LIB_HASH_UPDATE(_name, _init, _verify_signature, \
+			    _verify_hash, _calc_hash, _auth_decrypt, \
+			    _convert_pk, _verify_hash_init, \
+			    _verify_hash_update, _verify_hash_final, \
+			    _calc_hash_init, _calc_hash_update, \
+			    _calc_hash_final, _calc_hash_multi, \
+			    _get_digest_info) \
+	const crypto_lib_desc_t crypto_lib_desc = { \
+		.name = _name, \
+		.init = _init, \
+		.verify_signature = _verify_signature, \
+		.verify_hash = _verify_hash, \
+		.verify_hash_init = _verify_hash_init, \
+		.verify_hash_update = _verify_hash_update, \
+		.verify_hash_final = _verify_hash_final, \
+		.calc_hash = _calc_hash, \
+		.calc_hash_init = _calc_hash_init, \
+		.calc_hash_update = _calc_hash_update, \
+		.calc_hash_final = _calc_hash_final, \
+		.calc_hash_multi = _calc_hash_multi, \
+		.get_digest_info = _get_digest_info, \
+		.auth_decrypt = _auth_decrypt, \
+		.convert_pk = _convert_pk \
+	}
+
 extern const crypto_lib_desc_t crypto_lib_desc;
 
 #endif /* CRYPTO_MOD_H */
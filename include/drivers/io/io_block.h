@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2016, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2016-2024, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -7,6 +7,8 @@
 #ifndef IO_BLOCK_H
 #define IO_BLOCK_H
 
+#include <stdbool.h>
+
 #include <drivers/io/io_storage.h>
 
 /* block devices ops */
@@ -15,10 +17,49 @@ typedef struct io_block_ops {
 	size_t	(*write)(int lba, const uintptr_t buf, size_t size);
 } io_block_ops_t;
 
+/* Tag of a block held in a line of an io_block cache */
+typedef struct io_block_cache_tag {
+	int		lba;
+	unsigned int	age;
+	bool		valid;
+} io_block_cache_tag_t;
+
+/*
+ * Optional set-associative cache of the blocks read from a device. The
+ * platform provides the memory: 'data' holds 'sets * ways' blocks and 'tags'
+ * holds 'sets * ways' entries. 'sets' must be a power of two. A cache must
+ * not be shared between devices.
+ *
+ * When a read misses and follows on from the previous one, up to 'read_ahead'
+ * more blocks are read into the cache. 'hits' and 'misses' count the blocks
+ * read from the cache and from the device.
+ */
+typedef struct io_block_cache {
+	uintptr_t		data;
+	io_block_cache_tag_t	*tags;
+	unsigned int		sets;
+	unsigned int		ways;
+	unsigned int		read_ahead;
+	unsigned long		hits;
+	unsigned long		misses;
+} io_block_cache_t;
+
 typedef struct io_block_dev_spec {
 	io_block_spec_t	buffer;
 	io_block_ops_t	ops;
 	size_t		block_size;
+	/*
+	 * Alignment that ops.read() requires for its destination buffer. When
+	 * non-zero, whole blocks are read straight into the caller's buffer if
+	 * it has this alignment, instead of going through 'buffer'. Zero
+	 * restricts ops.read() to 'buffer'.
+	 */
+	size_t		direct_read_align;
+	/*
+	 * Block cache in front of ops.read(), or NULL. Cache misses are read
+	 * through 'buffer', so reads larger than 'buffer' bypass the cache.
+	 */
+	io_block_cache_t	*cache;
 } io_block_dev_spec_t;
 
 struct io_dev_connector;
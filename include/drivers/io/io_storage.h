@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2014-2022, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2014-2024, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -82,6 +82,16 @@ int io_dev_init(uintptr_t dev_handle, const uintptr_t init_params);
 /* Close a connection to a device */
 int io_dev_close(uintptr_t dev_handle);
 
+/* Close the devices kept open when PERSISTENT_IO_DEVICES is enabled */
+#if PERSISTENT_IO_DEVICES
+int io_dev_close_all(void);
+#else
+static inline int io_dev_close_all(void)
+{
+	return 0;
+}
+#endif /* PERSISTENT_IO_DEVICES */
+
 
 /* Synchronous operations */
 int io_open(uintptr_t dev_handle, const uintptr_t spec, uintptr_t *handle);
@@ -36,8 +36,41 @@
 #error "Not supported EVENT_LOG_LEVEL"
 #endif
 
-/* Number of hashing algorithms supported */
-#define HASH_ALG_COUNT		1U
+/*
+ * PCR banks recorded in addition to the one of TPM_ALG_ID, selected by the
+ * MBOOT_EL_EXTRA_HASH_ALGS build option
+ */
+#ifndef EVENT_LOG_EXTRA_SHA256
+#define EVENT_LOG_EXTRA_SHA256	0
+#endif
+#ifndef EVENT_LOG_EXTRA_SHA384
+#define EVENT_LOG_EXTRA_SHA384	0
+#endif
+#ifndef EVENT_LOG_EXTRA_SHA512
+#define EVENT_LOG_EXTRA_SHA512	0
+#endif
+
+/* Number of hashing algorithms supported, i.e. of PCR banks */
+#define HASH_ALG_COUNT		(1U + EVENT_LOG_EXTRA_SHA256 + \
+				 EVENT_LOG_EXTRA_SHA384 + \
+				 EVENT_LOG_EXTRA_SHA512)
+
+/* Size of the digests of an event, back to back in the order of the banks */
+#define EVENT_LOG_HASH_SIZE	(TCG_DIGEST_SIZE + \
+				 (EVENT_LOG_EXTRA_SHA256 * SHA256_DIGEST_SIZE) + \
+				 (EVENT_LOG_EXTRA_SHA384 * SHA384_DIGEST_SIZE) + \
+				 (EVENT_LOG_EXTRA_SHA512 * SHA512_DIGEST_SIZE))
+
+/*
+ * Size of the buffers holding the digests of an event, which may also be
+ * passed to crypto_mod_calc_hash()
+ */
+#define EVENT_LOG_HASH_BUF_SIZE	((EVENT_LOG_HASH_SIZE > CRYPTO_MD_MAX_SIZE) ? \
+				 EVENT_LOG_HASH_SIZE : CRYPTO_MD_MAX_SIZE)
+
+/* Size of TCG_PCR_EVENT2.Digests[] */
+#define EVENT_LOG_DIGESTS_SIZE	((sizeof(tpmt_ha) * HASH_ALG_COUNT) + \
+				 EVENT_LOG_HASH_SIZE)
 
 #define EVLOG_INVALID_ID	UINT32_MAX
 
@@ -54,14 +87,14 @@ typedef struct {
 			sizeof(id_event_struct_data_t))
 
 #define	LOC_EVENT_SIZE	(sizeof(event2_header_t) + \
-			sizeof(tpmt_ha) + TCG_DIGEST_SIZE + \
+			EVENT_LOG_DIGESTS_SIZE + \
 			sizeof(event2_data_t) + \
 			sizeof(startup_locality_event_t))
 
 #define	LOG_MIN_SIZE	(ID_EVENT_SIZE + LOC_EVENT_SIZE)
 
 #define EVENT2_HDR_SIZE	(sizeof(event2_header_t) + \
-			sizeof(tpmt_ha) + TCG_DIGEST_SIZE + \
+			EVENT_LOG_DIGESTS_SIZE + \
 			sizeof(event2_data_t))
 
 /* Functions' declarations */
@@ -71,7 +104,7 @@ void event_log_write_specid_event(void);
 void event_log_write_header(void);
 void dump_event_log(uint8_t *log_addr, size_t log_size);
 int event_log_measure(uintptr_t data_base, uint32_t data_size,
-		      unsigned char hash_data[CRYPTO_MD_MAX_SIZE]);
+		      unsigned char hash_data[EVENT_LOG_HASH_BUF_SIZE]);
 void event_log_record(const uint8_t *hash, uint32_t event_type,
 		      const event_log_metadata_t *metadata_ptr);
 int event_log_measure_and_record(uintptr_t data_base, uint32_t data_size,
@@ -27,6 +27,13 @@ CASSERT((PLAT_PARTITION_BLOCK_SIZE == 512) ||
 	(PLAT_PARTITION_BLOCK_SIZE == 4096),
 	assert_plat_partition_block_size);
 
+#if !PLAT_PARTITION_READ_SIZE
+# define PLAT_PARTITION_READ_SIZE	PLAT_PARTITION_BLOCK_SIZE
+#endif /* PLAT_PARTITION_READ_SIZE */
+
+CASSERT((PLAT_PARTITION_READ_SIZE % PLAT_PARTITION_BLOCK_SIZE) == 0,
+	assert_plat_partition_read_size);
+
 #define LEGACY_PARTITION_BLOCK_SIZE	512
 
 #define LBA(n) ((unsigned long long)(n) * PLAT_PARTITION_BLOCK_SIZE)
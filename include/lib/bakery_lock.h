@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2018, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2013-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -51,7 +51,27 @@ static inline uint16_t make_bakery_data(unsigned int choosing, unsigned int num)
 /*****************************************************************************
  * External bakery lock interface.
  ****************************************************************************/
-#if USE_COHERENT_MEM
+#if USE_BAKERY_TICKET_LOCK
+/*
+ * Bakery locks are implemented as ticket locks
+ *
+ * All CPUs taking the lock are cache-coherent, so a lock is a single word
+ * updated with exclusive or atomic instructions instead of one field per CPU.
+ * A CPU takes the next ticket and waits for the owner ticket to reach it, so
+ * the lock is handed over in the order it was requested, as with the bakery
+ * algorithm.
+ */
+
+typedef struct bakery_lock {
+	/*
+	 * The lock_data is a bit-field of 2 members:
+	 * Bits[0 - 15]  : owner. This is the ticket holding the lock.
+	 * Bits[16 - 31] : next. This is the next ticket to be given out.
+	 */
+	volatile uint32_t lock_data;
+} bakery_lock_t;
+
+#elif USE_COHERENT_MEM
 /*
  * Bakery locks are stored in coherent memory
  *
@@ -90,13 +110,18 @@ typedef struct bakery_info {
 
 typedef bakery_info_t bakery_lock_t;
 
-#endif /* __USE_COHERENT_MEM__ */
+#endif /* USE_BAKERY_TICKET_LOCK */
 
 static inline void bakery_lock_init(bakery_lock_t *bakery) {}
 void bakery_lock_get(bakery_lock_t *bakery);
 void bakery_lock_release(bakery_lock_t *bakery);
 
+#if USE_BAKERY_TICKET_LOCK
+/* Ticket locks are shared by all CPUs and need no per-CPU copies */
+#define DEFINE_BAKERY_LOCK(_name) bakery_lock_t _name
+#else
 #define DEFINE_BAKERY_LOCK(_name) bakery_lock_t _name __section(".bakery_lock")
+#endif
 
 #define DECLARE_BAKERY_LOCK(_name) extern bakery_lock_t _name
 
@@ -65,7 +65,7 @@
 						CACHE_WRITEBACK_GRANULE) * \
 							CACHE_WRITEBACK_GRANULE)
 
-#if ENABLE_RUNTIME_INSTRUMENTATION
+#if ENABLE_RUNTIME_INSTRUMENTATION || ENABLE_SMC_LATENCY_STATS
 /* Temporary space to store PMF timestamps from assembly code */
 #define CPU_DATA_PMF_TS_COUNT		1
 #define CPU_DATA_PMF_TS0_OFFSET		CPU_DATA_CRASH_BUF_END
@@ -128,7 +128,7 @@ typedef struct cpu_data {
 #if CRASH_REPORTING
 	u_register_t crash_buf[CPU_DATA_CRASH_BUF_SIZE >> 3];
 #endif
-#if ENABLE_RUNTIME_INSTRUMENTATION
+#if ENABLE_RUNTIME_INSTRUMENTATION || ENABLE_SMC_LATENCY_STATS
 	uint64_t cpu_data_pmf_ts[CPU_DATA_PMF_TS_COUNT];
 #endif
 #if PLAT_PCPU_DATA_SIZE
@@ -166,7 +166,7 @@ CASSERT(CPU_DATA_CPU_OPS_PTR == __builtin_offsetof
 		(cpu_data_t, cpu_ops_ptr),
 		assert_cpu_data_cpu_ops_ptr_offset_mismatch);
 
-#if ENABLE_RUNTIME_INSTRUMENTATION
+#if ENABLE_RUNTIME_INSTRUMENTATION || ENABLE_SMC_LATENCY_STATS
 CASSERT(CPU_DATA_PMF_TS0_OFFSET == __builtin_offsetof
 		(cpu_data_t, cpu_data_pmf_ts[0]),
 		assert_cpu_data_pmf_ts0_offset_mismatch);
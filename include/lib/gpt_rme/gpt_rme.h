@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022, Arm Limited. All rights reserved.
+ * Copyright (c) 2022-2024, Arm Limited. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -263,7 +263,9 @@ void gpt_disable(void);
  * transition request occurs it is routed to this function where the request is
  * validated then fulfilled if possible.
  *
- * TODO: implement support for transitioning multiple granules at once.
+ * Several granules can be transitioned at once, as long as the region does not
+ * cross an L0 region boundary (L0GPTSZ). Either the whole region is
+ * transitioned or none of it is.
  *
  * Parameters
  *   base: Base address of the region to transition, must be aligned to granule
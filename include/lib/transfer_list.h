@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, Linaro Limited and Contributors. All rights reserved.
+ * Copyright (c) 2023-2024, Linaro Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -89,6 +89,18 @@ struct transfer_list_entry {
 	 */
 };
 
+/*
+ * Description of an entry to add with transfer_list_add_batch(). 'te' is set
+ * to the added entry, or NULL if it could not be added.
+ */
+struct transfer_list_entry_desc {
+	uint16_t tag_id;
+	uint8_t alignment; /* TE data alignment, as a power of two */
+	uint32_t data_size;
+	const void *data; /* copied into the TE data unless NULL */
+	struct transfer_list_entry *te;
+};
+
 void transfer_list_dump(struct transfer_list_header *tl);
 entry_point_info_t *
 transfer_list_set_handoff_args(struct transfer_list_header *tl,
@@ -122,6 +134,10 @@ transfer_list_add_with_align(struct transfer_list_header *tl, uint16_t tag_id,
 			     uint32_t data_size, const void *data,
 			     uint8_t alignment);
 
+unsigned int transfer_list_add_batch(struct transfer_list_header *tl,
+				     struct transfer_list_entry_desc *descs,
+				     unsigned int count);
+
 struct transfer_list_entry *
 transfer_list_next(struct transfer_list_header *tl,
 		   struct transfer_list_entry *last);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2017-2021, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2017-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -337,6 +337,30 @@ int mmap_remove_dynamic_region_ctx(xlat_ctx_t *ctx,
 				uintptr_t base_va,
 				size_t size);
 
+/*
+ * Add an array of 'count' dynamic regions with defined base PA and base VA.
+ * Either all the regions are added or none of them is. This is cheaper than
+ * adding the regions one by one, as the translation table updates are only
+ * synchronized once.
+ *
+ * It returns the same error values as mmap_add_dynamic_region().
+ */
+int mmap_add_dynamic_regions(mmap_region_t *mm, unsigned int count);
+int mmap_add_dynamic_regions_ctx(xlat_ctx_t *ctx, mmap_region_t *mm,
+				 unsigned int count);
+
+/*
+ * Remove an array of 'count' dynamic regions with the specified base VAs and
+ * sizes. Regions of size 0 are ignored. Either all the regions are removed or
+ * none of them is. The TLB entries of all the regions are invalidated at once,
+ * with range TLBI operations if FEAT_TLBIRANGE is implemented.
+ *
+ * It returns the same error values as mmap_remove_dynamic_region().
+ */
+int mmap_remove_dynamic_regions(const mmap_region_t *mm, unsigned int count);
+int mmap_remove_dynamic_regions_ctx(xlat_ctx_t *ctx, const mmap_region_t *mm,
+				    unsigned int count);
+
 #endif /* PLAT_XLAT_TABLES_DYNAMIC */
 
 /*
@@ -348,8 +372,9 @@ int mmap_remove_dynamic_region_ctx(xlat_ctx_t *ctx,
  *
  * The base address of the memory region must be aligned on a page boundary.
  * The size of this memory region must be a multiple of a page size.
- * The memory region must be already mapped by the given translation tables
- * and it must be mapped at the granularity of a page.
+ * The memory region must be already mapped by the given translation tables.
+ * Block mappings are changed as a whole, so a block must either be fully
+ * inside the region or not overlap it at all.
  *
  * Return 0 on success, a negative value on error.
  *
@@ -378,6 +403,9 @@ int mmap_remove_dynamic_region_ctx(xlat_ctx_t *ctx,
  * NOTE2: The caller is responsible for making sure that the targeted
  * translation tables are not modified by any other code while this function is
  * executing.
+ *
+ * NOTE3: The whole memory region is unmapped while its attributes are being
+ * changed, so it must not hold the code or data used by this function.
  */
 int xlat_change_mem_attributes_ctx(const xlat_ctx_t *ctx, uintptr_t base_va,
 				   size_t size, uint32_t attr);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2017-2020, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2017-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -80,6 +80,12 @@ struct xlat_ctx {
 	 */
 #if PLAT_XLAT_TABLES_DYNAMIC
 	int *tables_mapped_regions;
+
+	/*
+	 * Index of the first table of the list of free tables, or -1 if there
+	 * is none. It is set up when the translation tables are initialized.
+	 */
+	int free_table;
 #endif /* PLAT_XLAT_TABLES_DYNAMIC */
 
 	int next_table;
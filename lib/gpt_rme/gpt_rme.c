@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022, Arm Limited. All rights reserved.
+ * Copyright (c) 2022-2024, Arm Limited. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -20,6 +20,8 @@
 #include <lib/spinlock.h>
 #include <lib/xlat_tables/xlat_tables_v2.h>
 
+#include <platform_def.h>
+
 #if !ENABLE_RME
 #error "ENABLE_RME must be enabled to use the GPT library."
 #endif
@@ -955,33 +957,37 @@ int gpt_runtime_init(void)
 }
 
 /*
- * The L1 descriptors are protected by a spinlock to ensure that multiple
- * CPUs do not attempt to change the descriptors at once. In the future it
- * would be better to have separate spinlocks for each L1 descriptor.
+ * The L1 descriptors are protected by spinlocks to ensure that multiple CPUs
+ * do not attempt to change the same descriptors at once. The L0 regions share
+ * GPT_LOCK_COUNT locks so that transitions of granules in different regions
+ * can usually proceed in parallel. Each lock has its own cache line.
  */
-static spinlock_t gpt_lock;
+typedef struct {
+	spinlock_t lock;
+} __aligned(CACHE_WRITEBACK_GRANULE) gpt_lock_t;
 
-/*
- * A helper to write the value (target_pas << gpi_shift) to the index of
- * the gpt_l1_addr
- */
-static inline void write_gpt(uint64_t *gpt_l1_desc, uint64_t *gpt_l1_addr,
-			     unsigned int gpi_shift, unsigned int idx,
-			     unsigned int target_pas)
+static gpt_lock_t gpt_locks[GPT_LOCK_COUNT];
+
+static inline spinlock_t *gpt_get_lock(uint64_t base)
 {
-	*gpt_l1_desc &= ~(GPT_L1_GRAN_DESC_GPI_MASK << gpi_shift);
-	*gpt_l1_desc |= ((uint64_t)target_pas << gpi_shift);
-	gpt_l1_addr[idx] = *gpt_l1_desc;
+	return &gpt_locks[GPT_L0_IDX(base) & (GPT_LOCK_COUNT - 1U)].lock;
 }
 
 /*
- * Helper to retrieve the gpt_l1_* information from the base address
- * returned in gpi_info
+ * Helper to retrieve the L1 table covering the range [base, base + size).
+ * The range must not cross an L0 region boundary.
  */
-static int get_gpi_params(uint64_t base, gpi_info_t *gpi_info)
+static int get_l1_table(uint64_t base, size_t size, uint64_t **gpt_l1_addr)
 {
 	uint64_t gpt_l0_desc, *gpt_l0_base;
 
+	if (GPT_L0_IDX(base) != GPT_L0_IDX(base + size - 1UL)) {
+		VERBOSE("[GPT] Range crosses an L0 region boundary!\n");
+		VERBOSE("      Base=0x%" PRIx64 "\n", base);
+		VERBOSE("      Size=0x%lx\n", size);
+		return -EINVAL;
+	}
+
 	gpt_l0_base = (uint64_t *)gpt_config.plat_gpt_l0_base;
 	gpt_l0_desc = gpt_l0_base[GPT_L0_IDX(base)];
 	if (GPT_L0_TYPE(gpt_l0_desc) != GPT_L0_TYPE_TBL_DESC) {
@@ -990,14 +996,101 @@ static int get_gpi_params(uint64_t base, gpi_info_t *gpi_info)
 		return -EINVAL;
 	}
 
-	/* Get the table index and GPI shift from PA. */
-	gpi_info->gpt_l1_addr = GPT_L0_TBLD_ADDR(gpt_l0_desc);
-	gpi_info->idx = GPT_L1_IDX(gpt_config.p, base);
-	gpi_info->gpi_shift = GPT_L1_GPI_IDX(gpt_config.p, base) << 2;
+	*gpt_l1_addr = GPT_L0_TBLD_ADDR(gpt_l0_desc);
+	return 0;
+}
+
+/*
+ * Helper to check that every granule in [base, base + size) has the GPI
+ * 'gpi'. Returns the GPI of the first granule that does not, or 'gpi' if they
+ * all do.
+ */
+static unsigned int check_gpi_range(const uint64_t *gpt_l1_addr, uint64_t base,
+				    size_t size, unsigned int gpi)
+{
+	uint64_t pa;
+	unsigned int cur_gpi;
+
+	for (pa = base; pa < (base + size);
+	     pa += GPT_PGS_ACTUAL_SIZE(gpt_config.p)) {
+		cur_gpi = (gpt_l1_addr[GPT_L1_IDX(gpt_config.p, pa)] >>
+			   (GPT_L1_GPI_IDX(gpt_config.p, pa) << 2)) &
+			  GPT_L1_GRAN_DESC_GPI_MASK;
+		if (cur_gpi != gpi) {
+			return cur_gpi;
+		}
+	}
+
+	return gpi;
+}
+
+/*
+ * A helper to set the GPI of every granule in [base, base + size) to
+ * 'target_pas'. Each L1 descriptor is written once with all of its updated
+ * granules.
+ */
+static void write_gpt_range(uint64_t *gpt_l1_addr, uint64_t base, size_t size,
+			    unsigned int target_pas)
+{
+	uint64_t pa, gpt_l1_desc;
+	unsigned int idx, gpi_shift;
+
+	idx = GPT_L1_IDX(gpt_config.p, base);
+	gpt_l1_desc = gpt_l1_addr[idx];
+
+	for (pa = base; pa < (base + size);
+	     pa += GPT_PGS_ACTUAL_SIZE(gpt_config.p)) {
+		if (GPT_L1_IDX(gpt_config.p, pa) != idx) {
+			gpt_l1_addr[idx] = gpt_l1_desc;
+			idx = GPT_L1_IDX(gpt_config.p, pa);
+			gpt_l1_desc = gpt_l1_addr[idx];
+		}
+
+		gpi_shift = GPT_L1_GPI_IDX(gpt_config.p, pa) << 2;
+		gpt_l1_desc &= ~(GPT_L1_GRAN_DESC_GPI_MASK << gpi_shift);
+		gpt_l1_desc |= ((uint64_t)target_pas << gpi_shift);
+	}
+
+	gpt_l1_addr[idx] = gpt_l1_desc;
+}
+
+/*
+ * Helper to clean and invalidate the range [base, base + size) of the
+ * physical address space selected by 'nse' to the PoPA.
+ */
+static void flush_pas_range(uint64_t nse, uint64_t base, size_t size)
+{
+	if (is_feat_mte2_supported()) {
+		flush_dcache_to_popa_range_mte2(nse | base, size);
+	} else {
+		flush_dcache_to_popa_range(nse | base, size);
+	}
+}
+
+/*
+ * Helper to check the parameters common to delegate and undelegate requests.
+ */
+static int check_transition_range(uint64_t base, size_t size)
+{
+	/* Check that base and size are valid */
+	if ((ULONG_MAX - base) < size) {
+		VERBOSE("[GPT] Transition request address overflow!\n");
+		VERBOSE("      Base=0x%" PRIx64 "\n", base);
+		VERBOSE("      Size=0x%lx\n", size);
+		return -EINVAL;
+	}
+
+	/* Make sure base and size are valid. */
+	if (((base & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
+	    ((size & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
+	    (size == 0UL) ||
+	    ((base + size) >= GPT_PPS_ACTUAL_SIZE(gpt_config.t))) {
+		VERBOSE("[GPT] Invalid granule transition address range!\n");
+		VERBOSE("      Base=0x%" PRIx64 "\n", base);
+		VERBOSE("      Size=0x%lx\n", size);
+		return -EINVAL;
+	}
 
-	gpi_info->gpt_l1_desc = (gpi_info->gpt_l1_addr)[gpi_info->idx];
-	gpi_info->gpi = (gpi_info->gpt_l1_desc >> gpi_info->gpi_shift) &
-		GPT_L1_GRAN_DESC_GPI_MASK;
 	return 0;
 }
 
@@ -1006,7 +1099,8 @@ static int get_gpi_params(uint64_t base, gpi_info_t *gpi_info)
  * transition request occurs it is routed to this function to have the request,
  * if valid, fulfilled following A1.1.1 Delegate of RME supplement
  *
- * TODO: implement support for transitioning multiple granules at once.
+ * The range may hold several granules as long as it does not cross an L0
+ * region boundary. Either all of the granules are transitioned or none is.
  *
  * Parameters
  *   base		Base address of the region to transition, must be
@@ -1020,10 +1114,11 @@ static int get_gpi_params(uint64_t base, gpi_info_t *gpi_info)
  */
 int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 {
-	gpi_info_t gpi_info;
+	uint64_t *gpt_l1_addr;
+	spinlock_t *lock;
 	uint64_t nse;
 	int res;
-	unsigned int target_pas;
+	unsigned int gpi, target_pas;
 
 	/* Ensure that the tables have been set up before taking requests. */
 	assert(gpt_config.plat_gpt_l0_base != 0UL);
@@ -1035,28 +1130,14 @@ int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	assert(src_sec_state == SMC_FROM_REALM ||
 	       src_sec_state == SMC_FROM_SECURE);
 
-	/* See if this is a single or a range of granule transition. */
-	if (size != GPT_PGS_ACTUAL_SIZE(gpt_config.p)) {
-		return -EINVAL;
-	}
-
-	/* Check that base and size are valid */
-	if ((ULONG_MAX - base) < size) {
-		VERBOSE("[GPT] Transition request address overflow!\n");
-		VERBOSE("      Base=0x%" PRIx64 "\n", base);
-		VERBOSE("      Size=0x%lx\n", size);
-		return -EINVAL;
+	res = check_transition_range(base, size);
+	if (res != 0) {
+		return res;
 	}
 
-	/* Make sure base and size are valid. */
-	if (((base & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
-	    ((size & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
-	    (size == 0UL) ||
-	    ((base + size) >= GPT_PPS_ACTUAL_SIZE(gpt_config.t))) {
-		VERBOSE("[GPT] Invalid granule transition address range!\n");
-		VERBOSE("      Base=0x%" PRIx64 "\n", base);
-		VERBOSE("      Size=0x%lx\n", size);
-		return -EINVAL;
+	res = get_l1_table(base, size, &gpt_l1_addr);
+	if (res != 0) {
+		return res;
 	}
 
 	target_pas = GPT_GPI_REALM;
@@ -1065,23 +1146,20 @@ int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	}
 
 	/*
-	 * Access to L1 tables is controlled by a global lock to ensure
-	 * that no more than one CPU is allowed to make changes at any
-	 * given time.
+	 * Access to the L1 table is controlled by the lock of its L0 region
+	 * to ensure that no more than one CPU is allowed to make changes to
+	 * it at any given time.
 	 */
-	spin_lock(&gpt_lock);
-	res = get_gpi_params(base, &gpi_info);
-	if (res != 0) {
-		spin_unlock(&gpt_lock);
-		return res;
-	}
+	lock = gpt_get_lock(base);
+	spin_lock(lock);
 
-	/* Check that the current address is in NS state */
-	if (gpi_info.gpi != GPT_GPI_NS) {
+	/* Check that the whole range is in NS state */
+	gpi = check_gpi_range(gpt_l1_addr, base, size, GPT_GPI_NS);
+	if (gpi != GPT_GPI_NS) {
 		VERBOSE("[GPT] Only Granule in NS state can be delegated.\n");
 		VERBOSE("      Caller: %u, Current GPI: %u\n", src_sec_state,
-			gpi_info.gpi);
-		spin_unlock(&gpt_lock);
+			gpi);
+		spin_unlock(lock);
 		return -EPERM;
 	}
 
@@ -1096,40 +1174,27 @@ int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	 * states, remove any data speculatively fetched into the target
 	 * physical address space. Issue DC CIPAPA over address range
 	 */
-	if (is_feat_mte2_supported()) {
-		flush_dcache_to_popa_range_mte2(nse | base,
-					GPT_PGS_ACTUAL_SIZE(gpt_config.p));
-	} else {
-		flush_dcache_to_popa_range(nse | base,
-					   GPT_PGS_ACTUAL_SIZE(gpt_config.p));
-	}
+	flush_pas_range(nse, base, size);
 
-	write_gpt(&gpi_info.gpt_l1_desc, gpi_info.gpt_l1_addr,
-		  gpi_info.gpi_shift, gpi_info.idx, target_pas);
+	write_gpt_range(gpt_l1_addr, base, size, target_pas);
 	dsboshst();
 
-	gpt_tlbi_by_pa_ll(base, GPT_PGS_ACTUAL_SIZE(gpt_config.p));
+	gpt_tlbi_by_pa_ll(base, size);
 	dsbosh();
 
 	nse = (uint64_t)GPT_NSE_NS << GPT_NSE_SHIFT;
 
-	if (is_feat_mte2_supported()) {
-		flush_dcache_to_popa_range_mte2(nse | base,
-					   GPT_PGS_ACTUAL_SIZE(gpt_config.p));
-	} else {
-		flush_dcache_to_popa_range(nse | base,
-					   GPT_PGS_ACTUAL_SIZE(gpt_config.p));
-	}
+	flush_pas_range(nse, base, size);
 
-	/* Unlock access to the L1 tables. */
-	spin_unlock(&gpt_lock);
+	/* Unlock access to the L1 table. */
+	spin_unlock(lock);
 
 	/*
 	 * The isb() will be done as part of context
 	 * synchronization when returning to lower EL
 	 */
-	VERBOSE("[GPT] Granule 0x%" PRIx64 ", GPI 0x%x->0x%x\n",
-		base, gpi_info.gpi, target_pas);
+	VERBOSE("[GPT] Granules 0x%" PRIx64 "-0x%" PRIx64 ", GPI 0x%x->0x%x\n",
+		base, base + size - 1UL, GPT_GPI_NS, target_pas);
 
 	return 0;
 }
@@ -1139,7 +1204,8 @@ int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
  * transition request occurs it is routed to this function where the request is
  * validated then fulfilled if possible.
  *
- * TODO: implement support for transitioning multiple granules at once.
+ * The range may hold several granules as long as it does not cross an L0
+ * region boundary. Either all of the granules are transitioned or none is.
  *
  * Parameters
  *   base		Base address of the region to transition, must be
@@ -1153,9 +1219,11 @@ int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
  */
 int gpt_undelegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 {
-	gpi_info_t gpi_info;
+	uint64_t *gpt_l1_addr;
+	spinlock_t *lock;
 	uint64_t nse;
 	int res;
+	unsigned int gpi, current_pas;
 
 	/* Ensure that the tables have been set up before taking requests. */
 	assert(gpt_config.plat_gpt_l0_base != 0UL);
@@ -1167,52 +1235,36 @@ int gpt_undelegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	assert(src_sec_state == SMC_FROM_REALM ||
 	       src_sec_state == SMC_FROM_SECURE);
 
-	/* See if this is a single or a range of granule transition. */
-	if (size != GPT_PGS_ACTUAL_SIZE(gpt_config.p)) {
-		return -EINVAL;
+	res = check_transition_range(base, size);
+	if (res != 0) {
+		return res;
 	}
 
-	/* Check that base and size are valid */
-	if ((ULONG_MAX - base) < size) {
-		VERBOSE("[GPT] Transition request address overflow!\n");
-		VERBOSE("      Base=0x%" PRIx64 "\n", base);
-		VERBOSE("      Size=0x%lx\n", size);
-		return -EINVAL;
+	res = get_l1_table(base, size, &gpt_l1_addr);
+	if (res != 0) {
+		return res;
 	}
 
-	/* Make sure base and size are valid. */
-	if (((base & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
-	    ((size & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
-	    (size == 0UL) ||
-	    ((base + size) >= GPT_PPS_ACTUAL_SIZE(gpt_config.t))) {
-		VERBOSE("[GPT] Invalid granule transition address range!\n");
-		VERBOSE("      Base=0x%" PRIx64 "\n", base);
-		VERBOSE("      Size=0x%lx\n", size);
-		return -EINVAL;
+	current_pas = GPT_GPI_REALM;
+	if (src_sec_state == SMC_FROM_SECURE) {
+		current_pas = GPT_GPI_SECURE;
 	}
 
 	/*
-	 * Access to L1 tables is controlled by a global lock to ensure
-	 * that no more than one CPU is allowed to make changes at any
-	 * given time.
+	 * Access to the L1 table is controlled by the lock of its L0 region
+	 * to ensure that no more than one CPU is allowed to make changes to
+	 * it at any given time.
 	 */
-	spin_lock(&gpt_lock);
+	lock = gpt_get_lock(base);
+	spin_lock(lock);
 
-	res = get_gpi_params(base, &gpi_info);
-	if (res != 0) {
-		spin_unlock(&gpt_lock);
-		return res;
-	}
-
-	/* Check that the current address is in the delegated state */
-	if ((src_sec_state == SMC_FROM_REALM  &&
-	     gpi_info.gpi != GPT_GPI_REALM) ||
-	    (src_sec_state == SMC_FROM_SECURE &&
-	     gpi_info.gpi != GPT_GPI_SECURE)) {
+	/* Check that the whole range is in the delegated state */
+	gpi = check_gpi_range(gpt_l1_addr, base, size, current_pas);
+	if (gpi != current_pas) {
 		VERBOSE("[GPT] Only Granule in REALM or SECURE state can be undelegated.\n");
 		VERBOSE("      Caller: %u, Current GPI: %u\n", src_sec_state,
-			gpi_info.gpi);
-		spin_unlock(&gpt_lock);
+			gpi);
+		spin_unlock(lock);
 		return -EPERM;
 	}
 
@@ -1222,11 +1274,10 @@ int gpt_undelegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	 * to the currently-accessible physical address space will not
 	 * later become observable.
 	 */
-	write_gpt(&gpi_info.gpt_l1_desc, gpi_info.gpt_l1_addr,
-		  gpi_info.gpi_shift, gpi_info.idx, GPT_GPI_NO_ACCESS);
+	write_gpt_range(gpt_l1_addr, base, size, GPT_GPI_NO_ACCESS);
 	dsboshst();
 
-	gpt_tlbi_by_pa_ll(base, GPT_PGS_ACTUAL_SIZE(gpt_config.p));
+	gpt_tlbi_by_pa_ll(base, size);
 	dsbosh();
 
 	if (src_sec_state == SMC_FROM_SECURE) {
@@ -1236,13 +1287,7 @@ int gpt_undelegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	}
 
 	/* Ensure that the scrubbed data has made it past the PoPA */
-	if (is_feat_mte2_supported()) {
-		flush_dcache_to_popa_range_mte2(nse | base,
-					   GPT_PGS_ACTUAL_SIZE(gpt_config.p));
-	} else {
-		flush_dcache_to_popa_range(nse | base,
-					   GPT_PGS_ACTUAL_SIZE(gpt_config.p));
-	}
+	flush_pas_range(nse, base, size);
 
 	/*
 	 * Remove any data loaded speculatively
@@ -1250,32 +1295,25 @@ int gpt_undelegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	 */
 	nse = (uint64_t)GPT_NSE_NS << GPT_NSE_SHIFT;
 
-	if (is_feat_mte2_supported()) {
-		flush_dcache_to_popa_range_mte2(nse | base,
-					   GPT_PGS_ACTUAL_SIZE(gpt_config.p));
-	} else {
-		flush_dcache_to_popa_range(nse | base,
-					   GPT_PGS_ACTUAL_SIZE(gpt_config.p));
-	}
+	flush_pas_range(nse, base, size);
 
-	/* Clear existing GPI encoding and transition granule. */
-	write_gpt(&gpi_info.gpt_l1_desc, gpi_info.gpt_l1_addr,
-		  gpi_info.gpi_shift, gpi_info.idx, GPT_GPI_NS);
+	/* Clear existing GPI encoding and transition granules. */
+	write_gpt_range(gpt_l1_addr, base, size, GPT_GPI_NS);
 	dsboshst();
 
 	/* Ensure that all agents observe the new NS configuration */
-	gpt_tlbi_by_pa_ll(base, GPT_PGS_ACTUAL_SIZE(gpt_config.p));
+	gpt_tlbi_by_pa_ll(base, size);
 	dsbosh();
 
-	/* Unlock access to the L1 tables. */
-	spin_unlock(&gpt_lock);
+	/* Unlock access to the L1 table. */
+	spin_unlock(lock);
 
 	/*
 	 * The isb() will be done as part of context
 	 * synchronization when returning to lower EL
 	 */
-	VERBOSE("[GPT] Granule 0x%" PRIx64 ", GPI 0x%x->0x%x\n",
-		base, gpi_info.gpi, GPT_GPI_NS);
+	VERBOSE("[GPT] Granules 0x%" PRIx64 "-0x%" PRIx64 ", GPI 0x%x->0x%x\n",
+		base, base + size - 1UL, current_pas, GPT_GPI_NS);
 
 	return 0;
 }
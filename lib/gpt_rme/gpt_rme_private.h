@@ -107,15 +107,10 @@ typedef enum {
 } gpt_p_val_e;
 
 /*
- * Internal structure to retrieve the values from get_gpi_info();
+ * Number of locks protecting the L1 tables. The L0 region of index n uses
+ * lock n modulo GPT_LOCK_COUNT, which must be a power of two.
  */
-typedef struct gpi_info {
-	uint64_t gpt_l1_desc;
-	uint64_t *gpt_l1_addr;
-	unsigned int idx;
-	unsigned int gpi_shift;
-	unsigned int gpi;
-} gpi_info_t;
+#define GPT_LOCK_COUNT			U(16)
 
 /* Max valid value for PGS. */
 #define GPT_PGS_MAX			(2U)
@@ -8,4 +8,6 @@
 include lib/libc/libc_common.mk
 
 LIBC_SRCS	+=	$(addprefix lib/libc/,		\
+			memcpy.c			\
+			memmove.c			\
 			memset.c)
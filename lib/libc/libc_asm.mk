@@ -8,8 +8,13 @@ include lib/libc/libc_common.mk
 
 ifeq (${ARCH},aarch64)
 LIBC_SRCS	+=	$(addprefix lib/libc/aarch64/,	\
+			memcpy.S			\
+			memmove.S			\
 			memset.S)
 else
+LIBC_SRCS	+=	$(addprefix lib/libc/,		\
+			memcpy.c			\
+			memmove.c)
 LIBC_SRCS	+=	$(addprefix lib/libc/aarch32/,	\
 			memset.S)
 endif
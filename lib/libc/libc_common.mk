@@ -10,9 +10,7 @@ LIBC_SRCS	:=	$(addprefix lib/libc/,		\
 			exit.c				\
 			memchr.c			\
 			memcmp.c			\
-			memcpy.c			\
 			memcpy_s.c			\
-			memmove.c			\
 			memrchr.c			\
 			printf.c			\
 			putchar.c			\
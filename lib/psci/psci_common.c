@@ -38,13 +38,36 @@ const spd_pm_ops_t *psci_spd_pm;
  * local states requested for a particular non cpu power domain by each cpu
  * within the domain.
  *
- * TODO: Dense packing of the requested states will cause cache thrashing
- * when multiple power domains write to it. If we allocate the requested
- * states at each power level in a cache-line aligned per-domain memory,
- * the cache thrashing can be avoided.
+ * Each non cpu power domain has its own array, which starts on a new cache line
+ * so that CPUs in different power domains do not write to the same line. The
+ * arrays are allocated in psci_init_req_local_pwr_states(), every CPU appears
+ * once per power level.
  */
-static plat_local_state_t
-	psci_req_local_pwr_states[PLAT_MAX_PWR_LVL][PLATFORM_CORE_COUNT];
+#define PSCI_REQ_STATES_SIZE	((PLAT_MAX_PWR_LVL * PLATFORM_CORE_COUNT) + \
+				 (PSCI_NUM_NON_CPU_PWR_DOMAINS *	\
+				  (CACHE_WRITEBACK_GRANULE - 1U)))
+
+static plat_local_state_t psci_req_local_pwr_states[PSCI_REQ_STATES_SIZE]
+	__aligned(CACHE_WRITEBACK_GRANULE);
+
+#if PSCI_CPU_COUNTERS
+/*
+ * Counts of the CPUs of a non cpu power domain, or of the system, that are in
+ * a given state. They are updated under 'lock' and read without it.
+ */
+typedef struct psci_cpu_counters {
+	spinlock_t lock;
+
+	/* CPUs whose affinity info state is OFF */
+	unsigned int cpus_off;
+
+	/* CPUs whose local power state is not RUN */
+	unsigned int cpus_not_run;
+} __aligned(CACHE_WRITEBACK_GRANULE) psci_cpu_counters_t;
+
+static psci_cpu_counters_t psci_pd_counters[PSCI_NUM_NON_CPU_PWR_DOMAINS];
+static psci_cpu_counters_t psci_system_counters;
+#endif /* PSCI_CPU_COUNTERS */
 
 unsigned int psci_plat_core_count;
 
@@ -173,8 +196,8 @@ void psci_query_sys_suspend_pwrstate(psci_power_state_t *state_info)
 static bool psci_is_last_cpu_to_idle_at_pwrlvl(unsigned int end_pwrlvl)
 {
 	unsigned int my_idx, lvl, parent_idx;
-	unsigned int cpu_start_idx, ncpus, cpu_idx;
-	plat_local_state_t local_state;
+	unsigned int cpu_start_idx __unused, ncpus, cpu_idx __unused;
+	plat_local_state_t local_state __unused;
 
 	if (end_pwrlvl == PSCI_CPU_PWR_LVL) {
 		return true;
@@ -182,13 +205,20 @@ static bool psci_is_last_cpu_to_idle_at_pwrlvl(unsigned int end_pwrlvl)
 
 	my_idx = plat_my_core_pos();
 
-	for (lvl = PSCI_CPU_PWR_LVL; lvl <= end_pwrlvl; lvl++) {
-		parent_idx = psci_cpu_pd_nodes[my_idx].parent_node;
+	parent_idx = psci_cpu_pd_nodes[my_idx].parent_node;
+	for (lvl = PSCI_CPU_PWR_LVL + 1U; lvl < end_pwrlvl; lvl++) {
+		parent_idx = psci_non_cpu_pd_nodes[parent_idx].parent_node;
 	}
 
-	cpu_start_idx = psci_non_cpu_pd_nodes[parent_idx].cpu_start_idx;
 	ncpus = psci_non_cpu_pd_nodes[parent_idx].ncpus;
 
+#if PSCI_CPU_RUN_COUNTERS
+	assert(is_local_state_run(psci_get_cpu_local_state()) != 0);
+
+	return psci_pd_counters[parent_idx].cpus_not_run == (ncpus - 1U);
+#else
+	cpu_start_idx = psci_non_cpu_pd_nodes[parent_idx].cpu_start_idx;
+
 	for (cpu_idx = cpu_start_idx; cpu_idx < cpu_start_idx + ncpus;
 			cpu_idx++) {
 		local_state = psci_get_cpu_local_state_by_idx(cpu_idx);
@@ -203,6 +233,7 @@ static bool psci_is_last_cpu_to_idle_at_pwrlvl(unsigned int end_pwrlvl)
 	}
 
 	return true;
+#endif
 }
 #endif
 
@@ -213,6 +244,11 @@ static bool psci_is_last_cpu_to_idle_at_pwrlvl(unsigned int end_pwrlvl)
  ******************************************************************************/
 bool psci_is_last_on_cpu(void)
 {
+#if PSCI_CPU_COUNTERS
+	assert(psci_get_aff_info_state() == AFF_STATE_ON);
+
+	return psci_system_counters.cpus_off == (psci_plat_core_count - 1U);
+#else
 	unsigned int cpu_idx, my_idx = plat_my_core_pos();
 
 	for (cpu_idx = 0; cpu_idx < psci_plat_core_count; cpu_idx++) {
@@ -229,6 +265,7 @@ bool psci_is_last_on_cpu(void)
 	}
 
 	return true;
+#endif
 }
 
 /*******************************************************************************
@@ -237,6 +274,9 @@ bool psci_is_last_on_cpu(void)
  ******************************************************************************/
 static bool psci_are_all_cpus_on(void)
 {
+#if PSCI_CPU_COUNTERS
+	return psci_system_counters.cpus_off == 0U;
+#else
 	unsigned int cpu_idx;
 
 	for (cpu_idx = 0; cpu_idx < psci_plat_core_count; cpu_idx++) {
@@ -246,8 +286,95 @@ static bool psci_are_all_cpus_on(void)
 	}
 
 	return true;
+#endif
+}
+
+#if PSCI_CPU_COUNTERS
+static void psci_add_to_counter(psci_cpu_counters_t *counters,
+				unsigned int *counter, int delta)
+{
+	spin_lock(&counters->lock);
+	*counter += (unsigned int)delta;
+	spin_unlock(&counters->lock);
+}
+
+/*
+ * Add 'delta' to the 'cpus_off' or 'cpus_not_run' counter of the system and
+ * of each power domain that contains the CPU at 'cpu_idx'.
+ */
+static void psci_update_cpu_counters(unsigned int cpu_idx, bool off, int delta)
+{
+	unsigned int lvl, parent_idx;
+	psci_cpu_counters_t *counters;
+
+	parent_idx = psci_cpu_pd_nodes[cpu_idx].parent_node;
+	for (lvl = PSCI_CPU_PWR_LVL + 1U; lvl <= PLAT_MAX_PWR_LVL; lvl++) {
+		counters = &psci_pd_counters[parent_idx];
+		psci_add_to_counter(counters, off ? &counters->cpus_off :
+				    &counters->cpus_not_run, delta);
+		parent_idx = psci_non_cpu_pd_nodes[parent_idx].parent_node;
+	}
+
+	if (off) {
+		psci_add_to_counter(&psci_system_counters,
+				    &psci_system_counters.cpus_off, delta);
+	}
 }
 
+/* Called when the affinity info state of a CPU is set */
+void psci_count_aff_info_state(unsigned int cpu_idx,
+			       aff_info_state_t old_state,
+			       aff_info_state_t new_state)
+{
+	if ((old_state == AFF_STATE_OFF) && (new_state != AFF_STATE_OFF)) {
+		psci_update_cpu_counters(cpu_idx, true, -1);
+	} else if ((old_state != AFF_STATE_OFF) &&
+		   (new_state == AFF_STATE_OFF)) {
+		psci_update_cpu_counters(cpu_idx, true, 1);
+	} else {
+		/* The CPU stays OFF or not OFF */
+	}
+}
+
+#if PSCI_CPU_RUN_COUNTERS
+/* Called when the local power state of a CPU is set */
+void psci_count_cpu_local_state(unsigned int cpu_idx,
+				plat_local_state_t old_state,
+				plat_local_state_t new_state)
+{
+	int was_run = is_local_state_run(old_state);
+	int is_run = is_local_state_run(new_state);
+
+	if ((was_run != 0) && (is_run == 0)) {
+		psci_update_cpu_counters(cpu_idx, false, 1);
+	} else if ((was_run == 0) && (is_run != 0)) {
+		psci_update_cpu_counters(cpu_idx, false, -1);
+	} else {
+		/* The CPU stays running or not running */
+	}
+}
+#endif /* PSCI_CPU_RUN_COUNTERS */
+
+/*
+ * Initialise the counters to match the initial state of the CPUs, which are
+ * all OFF. Called before the boot CPU is marked as running.
+ */
+void __init psci_init_cpu_counters(void)
+{
+	unsigned int idx;
+
+	for (idx = 0U; idx < PSCI_NUM_NON_CPU_PWR_DOMAINS; idx++) {
+		psci_pd_counters[idx].cpus_off =
+			psci_non_cpu_pd_nodes[idx].ncpus;
+		psci_pd_counters[idx].cpus_not_run =
+			psci_non_cpu_pd_nodes[idx].ncpus;
+	}
+
+	psci_system_counters.cpus_off = psci_plat_core_count;
+	psci_system_counters.cpus_not_run = psci_plat_core_count;
+}
+#endif /* PSCI_CPU_COUNTERS */
+
 /*******************************************************************************
  * Routine to return the maximum power level to traverse to after a cpu has
  * been physically powered up. It is expected to be called immediately after
@@ -270,6 +397,29 @@ static unsigned int get_power_on_target_pwrlvl(void)
 	return pwrlvl;
 }
 
+/******************************************************************************
+ * Helper function to return the index in psci_req_local_pwr_states of the local
+ * power state requested by the CPU at 'cpu_idx' for its ancestor power domain
+ * at 'pwrlvl'.
+ *****************************************************************************/
+static unsigned int psci_req_local_pwr_state_idx(unsigned int pwrlvl,
+						 unsigned int cpu_idx)
+{
+	unsigned int lvl, parent_idx;
+	const non_cpu_pd_node_t *node;
+
+	parent_idx = psci_cpu_pd_nodes[cpu_idx].parent_node;
+	for (lvl = PSCI_CPU_PWR_LVL + 1U; lvl < pwrlvl; lvl++) {
+		parent_idx = psci_non_cpu_pd_nodes[parent_idx].parent_node;
+	}
+
+	node = &psci_non_cpu_pd_nodes[parent_idx];
+	assert((cpu_idx >= node->cpu_start_idx) &&
+	       (cpu_idx < (node->cpu_start_idx + node->ncpus)));
+
+	return node->req_states_idx + (cpu_idx - node->cpu_start_idx);
+}
+
 /******************************************************************************
  * Helper function to update the requested local power state array. This array
  * does not store the requested state for the CPU power level. Hence an
@@ -282,24 +432,32 @@ static void psci_set_req_local_pwr_state(unsigned int pwrlvl,
 	assert(pwrlvl > PSCI_CPU_PWR_LVL);
 	if ((pwrlvl > PSCI_CPU_PWR_LVL) && (pwrlvl <= PLAT_MAX_PWR_LVL) &&
 			(cpu_idx < psci_plat_core_count)) {
-		psci_req_local_pwr_states[pwrlvl - 1U][cpu_idx] = req_pwr_state;
+		psci_req_local_pwr_states[psci_req_local_pwr_state_idx(pwrlvl,
+					  cpu_idx)] = req_pwr_state;
 	}
 }
 
 /******************************************************************************
- * This function initializes the psci_req_local_pwr_states.
+ * This function allocates the array of requested local power states of each
+ * non cpu power domain in psci_req_local_pwr_states, and initializes them.
  *****************************************************************************/
 void __init psci_init_req_local_pwr_states(void)
 {
-	/* Initialize the requested state of all non CPU power domains as OFF */
-	unsigned int pwrlvl;
-	unsigned int core;
+	unsigned int idx, next_idx = 0U;
 
-	for (pwrlvl = 0U; pwrlvl < PLAT_MAX_PWR_LVL; pwrlvl++) {
-		for (core = 0; core < psci_plat_core_count; core++) {
-			psci_req_local_pwr_states[pwrlvl][core] =
-				PLAT_MAX_OFF_STATE;
-		}
+	for (idx = 0U; idx < PSCI_NUM_NON_CPU_PWR_DOMAINS; idx++) {
+		next_idx = round_up(next_idx, CACHE_WRITEBACK_GRANULE);
+		psci_non_cpu_pd_nodes[idx].req_states_idx = next_idx;
+		next_idx += psci_non_cpu_pd_nodes[idx].ncpus;
+	}
+	assert(next_idx <= PSCI_REQ_STATES_SIZE);
+
+	psci_flush_dcache_range((uintptr_t)psci_non_cpu_pd_nodes,
+				sizeof(psci_non_cpu_pd_nodes));
+
+	/* Initialize the requested state of all non CPU power domains as OFF */
+	for (idx = 0U; idx < PSCI_REQ_STATES_SIZE; idx++) {
+		psci_req_local_pwr_states[idx] = PLAT_MAX_OFF_STATE;
 	}
 }
 
@@ -318,7 +476,8 @@ static plat_local_state_t *psci_get_req_local_pwr_states(unsigned int pwrlvl,
 
 	if ((pwrlvl > PSCI_CPU_PWR_LVL) && (pwrlvl <= PLAT_MAX_PWR_LVL) &&
 			(cpu_idx < psci_plat_core_count)) {
-		return &psci_req_local_pwr_states[pwrlvl - 1U][cpu_idx];
+		return &psci_req_local_pwr_states[
+			psci_req_local_pwr_state_idx(pwrlvl, cpu_idx)];
 	} else
 		return NULL;
 }
@@ -25,7 +25,9 @@ PSCI_LIB_SOURCES	+=	lib/el3_runtime/aarch64/context.S	\
 				lib/psci/aarch64/runtime_errata.S
 endif
 
-ifeq (${USE_COHERENT_MEM}, 1)
+ifeq (${USE_BAKERY_TICKET_LOCK}, 1)
+PSCI_LIB_SOURCES		+=	lib/locks/bakery/${ARCH}/bakery_lock_ticket.S
+else ifeq (${USE_COHERENT_MEM}, 1)
 PSCI_LIB_SOURCES		+=	lib/locks/bakery/bakery_lock_coherent.c
 else
 PSCI_LIB_SOURCES		+=	lib/locks/bakery/bakery_lock_normal.c
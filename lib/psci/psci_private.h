@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2023, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2013-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -16,6 +16,7 @@
 #include <lib/el3_runtime/cpu_data.h>
 #include <lib/psci/psci.h>
 #include <lib/spinlock.h>
+#include <plat/common/platform.h>
 
 /*
  * The PSCI capability which are provided by the generic code but does not
@@ -51,13 +52,31 @@
 #define PSCI_PARENT_NODE_INVALID	0xFFFFFFFFU
 
 /*
- * Helper functions to get/set the fields of PSCI per-cpu data.
+ * With hardware-assisted coherency, each non-CPU power domain keeps counts of
+ * the CPUs it contains that are OFF and, in OS-initiated mode, that are not
+ * running. They are updated by the helpers below on every change of state.
  */
-static inline void psci_set_aff_info_state(aff_info_state_t aff_state)
-{
-	set_cpu_data(psci_svc_cpu_data.aff_info_state, aff_state);
-}
+#if HW_ASSISTED_COHERENCY
+#define PSCI_CPU_COUNTERS		1
+#else
+#define PSCI_CPU_COUNTERS		0
+#endif
+#define PSCI_CPU_RUN_COUNTERS		(PSCI_CPU_COUNTERS && PSCI_OS_INIT_MODE)
+
+#if PSCI_CPU_COUNTERS
+void psci_count_aff_info_state(unsigned int cpu_idx,
+			       aff_info_state_t old_state,
+			       aff_info_state_t new_state);
+#endif
+#if PSCI_CPU_RUN_COUNTERS
+void psci_count_cpu_local_state(unsigned int cpu_idx,
+				plat_local_state_t old_state,
+				plat_local_state_t new_state);
+#endif
 
+/*
+ * Helper functions to get/set the fields of PSCI per-cpu data.
+ */
 static inline aff_info_state_t psci_get_aff_info_state(void)
 {
 	return get_cpu_data(psci_svc_cpu_data.aff_info_state);
@@ -69,11 +88,32 @@ static inline aff_info_state_t psci_get_aff_info_state_by_idx(unsigned int idx)
 				     psci_svc_cpu_data.aff_info_state);
 }
 
+static inline void psci_set_aff_info_state(aff_info_state_t aff_state)
+{
+#if PSCI_CPU_COUNTERS
+	aff_info_state_t old_state = psci_get_aff_info_state();
+#endif
+
+	set_cpu_data(psci_svc_cpu_data.aff_info_state, aff_state);
+
+#if PSCI_CPU_COUNTERS
+	psci_count_aff_info_state(plat_my_core_pos(), old_state, aff_state);
+#endif
+}
+
 static inline void psci_set_aff_info_state_by_idx(unsigned int idx,
 						  aff_info_state_t aff_state)
 {
+#if PSCI_CPU_COUNTERS
+	aff_info_state_t old_state = psci_get_aff_info_state_by_idx(idx);
+#endif
+
 	set_cpu_data_by_index(idx,
 			      psci_svc_cpu_data.aff_info_state, aff_state);
+
+#if PSCI_CPU_COUNTERS
+	psci_count_aff_info_state(idx, old_state, aff_state);
+#endif
 }
 
 static inline unsigned int psci_get_suspend_pwrlvl(void)
@@ -86,14 +126,22 @@ static inline void psci_set_suspend_pwrlvl(unsigned int target_lvl)
 	set_cpu_data(psci_svc_cpu_data.target_pwrlvl, target_lvl);
 }
 
-static inline void psci_set_cpu_local_state(plat_local_state_t state)
+static inline plat_local_state_t psci_get_cpu_local_state(void)
 {
-	set_cpu_data(psci_svc_cpu_data.local_state, state);
+	return get_cpu_data(psci_svc_cpu_data.local_state);
 }
 
-static inline plat_local_state_t psci_get_cpu_local_state(void)
+static inline void psci_set_cpu_local_state(plat_local_state_t state)
 {
-	return get_cpu_data(psci_svc_cpu_data.local_state);
+#if PSCI_CPU_RUN_COUNTERS
+	plat_local_state_t old_state = psci_get_cpu_local_state();
+#endif
+
+	set_cpu_data(psci_svc_cpu_data.local_state, state);
+
+#if PSCI_CPU_RUN_COUNTERS
+	psci_count_cpu_local_state(plat_my_core_pos(), old_state, state);
+#endif
 }
 
 static inline plat_local_state_t psci_get_cpu_local_state_by_idx(
@@ -143,6 +191,12 @@ typedef struct non_cpu_pwr_domain_node {
 
 	/* For indexing the psci_lock array*/
 	uint16_t lock_index;
+
+	/*
+	 * Index in psci_req_local_pwr_states of the local power state requested
+	 * for this node by the CPU at 'cpu_start_idx'.
+	 */
+	unsigned int req_states_idx;
 } non_cpu_pd_node_t;
 
 typedef struct cpu_pwr_domain_node {
@@ -177,12 +231,25 @@ typedef enum suspend_mode {
  * The following are helpers and declarations of locks.
  ******************************************************************************/
 #if HW_ASSISTED_COHERENCY
+#if USE_BAKERY_TICKET_LOCK
+/*
+ * Bakery locks are ticket locks on this system, which are handed over in the
+ * order they were requested, so use them rather than spinlocks.
+ */
+#define DEFINE_PSCI_LOCK(_name)		DEFINE_BAKERY_LOCK(_name)
+#define DECLARE_PSCI_LOCK(_name)	DECLARE_BAKERY_LOCK(_name)
+#define psci_lock_acquire(_lock)	bakery_lock_get(_lock)
+#define psci_lock_drop(_lock)		bakery_lock_release(_lock)
+#else
 /*
  * On systems where participant CPUs are cache-coherent, we can use spinlocks
  * instead of bakery locks.
  */
 #define DEFINE_PSCI_LOCK(_name)		spinlock_t _name
 #define DECLARE_PSCI_LOCK(_name)	extern DEFINE_PSCI_LOCK(_name)
+#define psci_lock_acquire(_lock)	spin_lock(_lock)
+#define psci_lock_drop(_lock)		spin_unlock(_lock)
+#endif
 
 /* One lock is required per non-CPU power domain node */
 DECLARE_PSCI_LOCK(psci_locks[PSCI_NUM_NON_CPU_PWR_DOMAINS]);
@@ -208,12 +275,12 @@ static inline void psci_dsbish(void)
 
 static inline void psci_lock_get(non_cpu_pd_node_t *non_cpu_pd_node)
 {
-	spin_lock(&psci_locks[non_cpu_pd_node->lock_index]);
+	psci_lock_acquire(&psci_locks[non_cpu_pd_node->lock_index]);
 }
 
 static inline void psci_lock_release(non_cpu_pd_node_t *non_cpu_pd_node)
 {
-	spin_unlock(&psci_locks[non_cpu_pd_node->lock_index]);
+	psci_lock_drop(&psci_locks[non_cpu_pd_node->lock_index]);
 }
 
 #else /* if HW_ASSISTED_COHERENCY == 0 */
@@ -287,6 +354,9 @@ int psci_validate_power_state(unsigned int power_state,
 			      psci_power_state_t *state_info);
 void psci_query_sys_suspend_pwrstate(psci_power_state_t *state_info);
 void psci_init_req_local_pwr_states(void);
+#if PSCI_CPU_COUNTERS
+void psci_init_cpu_counters(void);
+#endif
 #if PSCI_OS_INIT_MODE
 void psci_update_req_local_pwr_states(unsigned int end_pwrlvl,
 				      unsigned int cpu_idx,
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2020, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2013-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -223,6 +223,10 @@ int __init psci_setup(const psci_lib_args_t *lib_args)
 
 	psci_init_req_local_pwr_states();
 
+#if PSCI_CPU_COUNTERS
+	psci_init_cpu_counters();
+#endif
+
 	/*
 	 * Set the requested and target state of this CPU and all the higher
 	 * power domain levels for this CPU to run.
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, Linaro Limited and Contributors. All rights reserved.
+ * Copyright (c) 2023-2024, Linaro Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -13,6 +13,165 @@
 #include <lib/transfer_list.h>
 #include <lib/utils_def.h>
 
+#if TRANSFER_LIST_TAG_CACHE_SIZE
+/*
+ * Offsets of the entries returned by transfer_list_find(), so that looking up
+ * the same tag again does not walk the list. A cached entry is checked to
+ * still carry its tag before it is used. The offsets are dropped when the
+ * entries of a list are moved by the functions of this file. Lists that are
+ * changed in place by other means must be re-initialised or relocated.
+ */
+struct tl_tag_cache_line {
+	const struct transfer_list_header *tl;
+	uint32_t offset;
+	uint16_t tag_id;
+};
+
+static struct tl_tag_cache_line tl_tag_cache[TRANSFER_LIST_TAG_CACHE_SIZE];
+static unsigned int tl_tag_cache_next;
+
+static struct transfer_list_entry *
+tag_cache_find(struct transfer_list_header *tl, uint16_t tag_id)
+{
+	struct transfer_list_entry *te;
+	unsigned int i;
+
+	for (i = 0; i < TRANSFER_LIST_TAG_CACHE_SIZE; i++) {
+		if (tl_tag_cache[i].tl != tl ||
+		    tl_tag_cache[i].tag_id != tag_id) {
+			continue;
+		}
+
+		/* the entry must still be in the list and carry the tag */
+		if (tl_tag_cache[i].offset + sizeof(*te) > tl->size) {
+			return NULL;
+		}
+		te = (struct transfer_list_entry *)((uintptr_t)tl +
+						    tl_tag_cache[i].offset);
+		if (te->tag_id != tag_id || te->reserved0 != 0 ||
+		    te->hdr_size < sizeof(*te) ||
+		    (uint64_t)te->hdr_size + te->data_size >
+			    tl->size - tl_tag_cache[i].offset) {
+			return NULL;
+		}
+
+		return te;
+	}
+
+	return NULL;
+}
+
+static void tag_cache_add(const struct transfer_list_header *tl,
+			  uint16_t tag_id,
+			  const struct transfer_list_entry *te)
+{
+	struct tl_tag_cache_line *line = NULL;
+	unsigned int i;
+
+	for (i = 0; i < TRANSFER_LIST_TAG_CACHE_SIZE; i++) {
+		if (tl_tag_cache[i].tl == tl &&
+		    tl_tag_cache[i].tag_id == tag_id) {
+			line = &tl_tag_cache[i];
+			break;
+		}
+	}
+
+	if (!line) {
+		line = &tl_tag_cache[tl_tag_cache_next];
+		tl_tag_cache_next = (tl_tag_cache_next + 1) %
+				    TRANSFER_LIST_TAG_CACHE_SIZE;
+	}
+
+	line->tl = tl;
+	line->tag_id = tag_id;
+	line->offset = (uintptr_t)te - (uintptr_t)tl;
+}
+
+/* Drop the cached entries of a list found at or after 'offset' */
+static void tag_cache_drop(const struct transfer_list_header *tl,
+			   uint32_t offset)
+{
+	unsigned int i;
+
+	for (i = 0; i < TRANSFER_LIST_TAG_CACHE_SIZE; i++) {
+		if (tl_tag_cache[i].tl == tl &&
+		    tl_tag_cache[i].offset >= offset) {
+			tl_tag_cache[i].tl = NULL;
+		}
+	}
+}
+#else
+static struct transfer_list_entry *
+tag_cache_find(struct transfer_list_header *tl, uint16_t tag_id)
+{
+	return NULL;
+}
+
+static void tag_cache_add(const struct transfer_list_header *tl,
+			  uint16_t tag_id,
+			  const struct transfer_list_entry *te)
+{
+}
+
+static void tag_cache_drop(const struct transfer_list_header *tl,
+			   uint32_t offset)
+{
+}
+#endif /* TRANSFER_LIST_TAG_CACHE_SIZE */
+
+/*******************************************************************************
+ * Calculate the byte sum of a memory range
+ * Return byte sum of the range
+ ******************************************************************************/
+static uint8_t byte_sum(const void *addr, size_t size)
+{
+	const uint8_t *b = addr;
+	uint8_t cs = 0;
+	size_t n = 0;
+
+	for (n = 0; n < size; n++) {
+		cs += b[n];
+	}
+
+	return cs;
+}
+
+/*******************************************************************************
+ * Calculate the byte sum of a transfer list
+ * Return byte sum of the transfer list
+ ******************************************************************************/
+static uint8_t calc_byte_sum(const struct transfer_list_header *tl)
+{
+	return byte_sum(tl, tl->size);
+}
+
+/*******************************************************************************
+ * Calculate the byte sum of the header of a transfer list, leaving out the
+ * checksum itself
+ * Return byte sum of the header
+ ******************************************************************************/
+static uint8_t hdr_byte_sum(const struct transfer_list_header *tl)
+{
+	return byte_sum(tl, sizeof(*tl)) - tl->checksum;
+}
+
+/*******************************************************************************
+ * Update the checksum of a transfer list after a part of it has changed,
+ * without summing up the whole list again. 'old_sum' and 'new_sum' are the
+ * byte sums of the changed part before and after the change, the checksum
+ * excluded. Bytes past the old size of the list count for nothing in
+ * 'old_sum'.
+ ******************************************************************************/
+static void adjust_checksum(struct transfer_list_header *tl, uint8_t old_sum,
+			    uint8_t new_sum)
+{
+	if (!(tl->flags & TL_FLAGS_HAS_CHECKSUM)) {
+		return;
+	}
+
+	tl->checksum -= (uint8_t)(new_sum - old_sum);
+}
+
 void transfer_list_dump(struct transfer_list_header *tl)
 {
 	struct transfer_list_entry *te = NULL;
@@ -99,6 +258,8 @@ struct transfer_list_header *transfer_list_init(void *addr, size_t max_size)
 		return NULL;
 	}
 
+	tag_cache_drop(tl, 0);
+
 	memset(tl, 0, max_size);
 	tl->signature = TRANSFER_LIST_SIGNATURE;
 	tl->version = TRANSFER_LIST_VERSION;
@@ -125,6 +286,7 @@ transfer_list_relocate(struct transfer_list_header *tl, void *addr,
 	uintptr_t new_addr, align_mask, align_off;
 	struct transfer_list_header *new_tl;
 	uint32_t new_max_size;
+	uint8_t old_sum;
 
 	if (!tl || !addr || max_size == 0) {
 		return NULL;
@@ -145,11 +307,16 @@ transfer_list_relocate(struct transfer_list_header *tl, void *addr,
 		return NULL;
 	}
 
+	tag_cache_drop(tl, 0);
+	tag_cache_drop((struct transfer_list_header *)new_addr, 0);
+
+	/* only the max size changes, the entries are moved as they are */
+	old_sum = hdr_byte_sum(tl);
 	new_tl = (struct transfer_list_header *)new_addr;
 	memmove(new_tl, tl, tl->size);
 	new_tl->max_size = new_max_size;
 
-	transfer_list_update_checksum(new_tl);
+	adjust_checksum(new_tl, old_sum, hdr_byte_sum(new_tl));
 
 	return new_tl;
 }
@@ -255,23 +422,6 @@ struct transfer_list_entry *transfer_list_next(struct transfer_list_header *tl,
 	return te;
 }
 
-/*******************************************************************************
- * Calculate the byte sum of a transfer list
- * Return byte sum of the transfer list
- ******************************************************************************/
-static uint8_t calc_byte_sum(const struct transfer_list_header *tl)
-{
-	uint8_t *b = (uint8_t *)tl;
-	uint8_t cs = 0;
-	size_t n = 0;
-
-	for (n = 0; n < tl->size; n++) {
-		cs += b[n];
-	}
-
-	return cs;
-}
-
 /*******************************************************************************
  * Update the checksum of a transfer list
  * Return updated checksum of the transfer list
@@ -321,6 +471,7 @@ bool transfer_list_set_data_size(struct transfer_list_header *tl,
 	size_t gap = 0;
 	size_t mov_dis = 0;
 	size_t sz = 0;
+	uint8_t old_sum;
 
 	if (!tl || !te) {
 		return false;
@@ -342,6 +493,12 @@ bool transfer_list_set_data_size(struct transfer_list_header *tl,
 		return false;
 	}
 
+	/*
+	 * the entries after the TE are only moved, so the checksum only has
+	 * to account for the header and the TE up to its rounded up end
+	 */
+	old_sum = hdr_byte_sum(tl) + byte_sum(te, old_ev - (uintptr_t)te);
+
 	if (new_ev > old_ev) {
 		/*
 		 * move distance should be roundup
@@ -358,7 +515,9 @@ bool transfer_list_set_data_size(struct transfer_list_header *tl,
 		memmove((void *)ru_new_ev, (void *)old_ev, tl_old_ev - old_ev);
 		tl->size += mov_dis;
 		gap = ru_new_ev - new_ev;
+		tag_cache_drop(tl, old_ev - (uintptr_t)tl);
 	} else {
+		ru_new_ev = old_ev;
 		gap = old_ev - new_ev;
 	}
 
@@ -373,7 +532,9 @@ bool transfer_list_set_data_size(struct transfer_list_header *tl,
 
 	te->data_size = new_data_size;
 
-	transfer_list_update_checksum(tl);
+	adjust_checksum(tl, old_sum,
+			hdr_byte_sum(tl) +
+			byte_sum(te, ru_new_ev - (uintptr_t)te));
 	return true;
 }
 
@@ -384,34 +545,33 @@ bool transfer_list_set_data_size(struct transfer_list_header *tl,
 bool transfer_list_rem(struct transfer_list_header *tl,
 		       struct transfer_list_entry *te)
 {
+	uint8_t old_sum;
+
 	if (!tl || !te || (uintptr_t)te > (uintptr_t)tl + tl->size) {
 		return false;
 	}
+	old_sum = byte_sum(te, sizeof(*te));
 	te->tag_id = TL_TAG_EMPTY;
 	te->reserved0 = 0;
-	transfer_list_update_checksum(tl);
+	adjust_checksum(tl, old_sum, byte_sum(te, sizeof(*te)));
 	return true;
 }
 
 /*******************************************************************************
- * Add a new transfer entry into a transfer list
- * Compliant to 2.4.3 of Firmware handoff specification (v0.9)
+ * Add a new transfer entry at the tail of a transfer list, without updating
+ * the checksum
  * Return pointer to the added transfer entry or NULL on error
  ******************************************************************************/
-struct transfer_list_entry *transfer_list_add(struct transfer_list_header *tl,
-					      uint16_t tag_id,
-					      uint32_t data_size,
-					      const void *data)
+static struct transfer_list_entry *add_entry(struct transfer_list_header *tl,
+					     uint16_t tag_id,
+					     uint32_t data_size,
+					     const void *data)
 {
 	uintptr_t max_tl_ev, tl_ev, ev;
 	struct transfer_list_entry *te = NULL;
 	uint8_t *te_data = NULL;
 	size_t sz = 0;
 
-	if (!tl) {
-		return NULL;
-	}
-
 	max_tl_ev = (uintptr_t)tl + tl->max_size;
 	tl_ev = (uintptr_t)tl + tl->size;
 	ev = tl_ev;
@@ -442,30 +602,22 @@ struct transfer_list_entry *transfer_list_add(struct transfer_list_header *tl,
 		memmove(te_data, data, data_size);
 	}
 
-	transfer_list_update_checksum(tl);
-
 	return te;
 }
 
 /*******************************************************************************
- * Add a new transfer entry into a transfer list with specified new data
- * alignment requirement
- * Compliant to 2.4.4 of Firmware handoff specification (v0.9)
+ * Add a new transfer entry with specified data alignment requirement at the
+ * tail of a transfer list, without updating the checksum
  * Return pointer to the added transfer entry or NULL on error
  ******************************************************************************/
-struct transfer_list_entry *
-transfer_list_add_with_align(struct transfer_list_header *tl, uint16_t tag_id,
-			     uint32_t data_size, const void *data,
-			     uint8_t alignment)
+static struct transfer_list_entry *
+add_entry_with_align(struct transfer_list_header *tl, uint16_t tag_id,
+		     uint32_t data_size, const void *data, uint8_t alignment)
 {
 	struct transfer_list_entry *te = NULL;
 	uintptr_t tl_ev, ev, new_tl_ev;
 	size_t dummy_te_data_sz = 0;
 
-	if (!tl) {
-		return NULL;
-	}
-
 	tl_ev = (uintptr_t)tl + tl->size;
 	ev = tl_ev + sizeof(struct transfer_list_entry);
 
@@ -479,22 +631,98 @@ transfer_list_add_with_align(struct transfer_list_header *tl, uint16_t tag_id,
 			    sizeof(struct transfer_list_entry);
 		dummy_te_data_sz =
 			new_tl_ev - tl_ev - sizeof(struct transfer_list_entry);
-		if (!transfer_list_add(tl, TL_TAG_EMPTY, dummy_te_data_sz,
-				       NULL)) {
+		if (!add_entry(tl, TL_TAG_EMPTY, dummy_te_data_sz, NULL)) {
 			return NULL;
 		}
 	}
 
-	te = transfer_list_add(tl, tag_id, data_size, data);
+	te = add_entry(tl, tag_id, data_size, data);
 
 	if (alignment > tl->alignment) {
 		tl->alignment = alignment;
-		transfer_list_update_checksum(tl);
 	}
 
 	return te;
 }
 
+/*******************************************************************************
+ * Add a new transfer entry into a transfer list
+ * Compliant to 2.4.3 of Firmware handoff specification (v0.9)
+ * Return pointer to the added transfer entry or NULL on error
+ ******************************************************************************/
+struct transfer_list_entry *transfer_list_add(struct transfer_list_header *tl,
+					      uint16_t tag_id,
+					      uint32_t data_size,
+					      const void *data)
+{
+	return transfer_list_add_with_align(tl, tag_id, data_size, data, 0);
+}
+
+/*******************************************************************************
+ * Add a new transfer entry into a transfer list with specified new data
+ * alignment requirement
+ * Compliant to 2.4.4 of Firmware handoff specification (v0.9)
+ * Return pointer to the added transfer entry or NULL on error
+ ******************************************************************************/
+struct transfer_list_entry *
+transfer_list_add_with_align(struct transfer_list_header *tl, uint16_t tag_id,
+			     uint32_t data_size, const void *data,
+			     uint8_t alignment)
+{
+	struct transfer_list_entry_desc desc = {
+		.tag_id = tag_id,
+		.alignment = alignment,
+		.data_size = data_size,
+		.data = data,
+	};
+
+	if (transfer_list_add_batch(tl, &desc, 1) != 1) {
+		return NULL;
+	}
+
+	return desc.te;
+}
+
+/*******************************************************************************
+ * Add several new transfer entries into a transfer list, in order. The
+ * checksum is updated once all the entries are added, from the byte sum of
+ * the new entries only. Each descriptor gets a pointer to its added entry.
+ * Return the number of entries added, which is less than 'count' if the
+ * transfer list runs out of space
+ ******************************************************************************/
+unsigned int transfer_list_add_batch(struct transfer_list_header *tl,
+				     struct transfer_list_entry_desc *descs,
+				     unsigned int count)
+{
+	uintptr_t tl_ev;
+	uint8_t old_sum;
+	unsigned int i;
+
+	if (!tl || !descs) {
+		return 0;
+	}
+
+	tl_ev = (uintptr_t)tl + tl->size;
+	old_sum = hdr_byte_sum(tl);
+
+	for (i = 0; i < count; i++) {
+		descs[i].te = add_entry_with_align(tl, descs[i].tag_id,
+						   descs[i].data_size,
+						   descs[i].data,
+						   descs[i].alignment);
+		if (!descs[i].te) {
+			break;
+		}
+	}
+
+	adjust_checksum(tl, old_sum,
+			hdr_byte_sum(tl) +
+			byte_sum((void *)tl_ev,
+				 (uintptr_t)tl + tl->size - tl_ev));
+
+	return i;
+}
+
 /*******************************************************************************
  * Search for an existing transfer entry with the specified tag id from a
  * transfer list
@@ -505,10 +733,29 @@ struct transfer_list_entry *transfer_list_find(struct transfer_list_header *tl,
 {
 	struct transfer_list_entry *te = NULL;
 
+	if (!tl) {
+		return NULL;
+	}
+
+	if (tag_id != TL_TAG_EMPTY) {
+		te = tag_cache_find(tl, tag_id);
+		if (te) {
+			return te;
+		}
+	}
+
 	do {
 		te = transfer_list_next(tl, te);
 	} while (te && (te->tag_id != tag_id || te->reserved0 != 0));
 
+	/*
+	 * entries are only added at the tail, so the first entry with the tag
+	 * stays the first one until it is removed or moved
+	 */
+	if (te && tag_id != TL_TAG_EMPTY) {
+		tag_cache_add(tl, tag_id, te);
+	}
+
 	return te;
 }
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2017-2023, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2017-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -183,14 +183,8 @@ uint64_t xlat_arch_regime_get_xn_desc(int xlat_regime)
 	}
 }
 
-void xlat_arch_tlbi_va(uintptr_t va, int xlat_regime)
+static void xlat_arch_tlbi_page(uintptr_t va, int xlat_regime)
 {
-	/*
-	 * Ensure the translation table write has drained into memory before
-	 * invalidating the TLB entry.
-	 */
-	dsbishst();
-
 	/*
 	 * This function only supports invalidation of TLB entries for the EL3
 	 * and EL1&0 translation regimes.
@@ -211,6 +205,104 @@ void xlat_arch_tlbi_va(uintptr_t va, int xlat_regime)
 	}
 }
 
+void xlat_arch_tlbi_va(uintptr_t va, int xlat_regime)
+{
+	/*
+	 * Ensure the translation table write has drained into memory before
+	 * invalidating the TLB entry.
+	 */
+	dsbishst();
+
+	xlat_arch_tlbi_page(va, xlat_regime);
+}
+
+/*
+ * Invalidate 'pages' pages from 'va' with as few range TLBI operations as
+ * possible. Each one covers a multiple of 2^(5 * SCALE + 1) pages, so a single
+ * page left at the end is invalidated on its own.
+ */
+static void xlat_arch_tlbi_range(uintptr_t va, unsigned long pages,
+				 int xlat_regime)
+{
+	CASSERT(PAGE_SIZE == PAGE_SIZE_4KB, assert_tlbi_range_granule);
+
+	while (pages != 0UL) {
+		unsigned int scale = TLBI_RANGE_MAX_SCALE;
+		unsigned long num;
+		uint64_t op;
+
+		if (pages == 1UL) {
+			xlat_arch_tlbi_page(va, xlat_regime);
+			break;
+		}
+
+		while (TLBI_RANGE_PAGES(1U, scale) > pages) {
+			scale--;
+		}
+
+		num = pages / TLBI_RANGE_PAGES(1U, scale);
+		if (num > TLBI_RANGE_MAX_NUM) {
+			num = TLBI_RANGE_MAX_NUM;
+		}
+
+		op = (((uint64_t)va >> PAGE_SIZE_SHIFT) & TLBI_RANGE_BADDR_MASK) |
+		     ((uint64_t)(num - 1UL) << TLBI_RANGE_NUM_SHIFT) |
+		     ((uint64_t)scale << TLBI_RANGE_SCALE_SHIFT) |
+		     (TLBI_RANGE_TG_4K << TLBI_RANGE_TG_SHIFT);
+
+		if (xlat_regime == EL1_EL0_REGIME) {
+			tlbirvaae1is(op);
+		} else if (xlat_regime == EL2_REGIME) {
+			tlbirvae2is(op);
+		} else {
+			tlbirvae3is(op);
+		}
+
+		va += TLBI_RANGE_PAGES(num, scale) << PAGE_SIZE_SHIFT;
+		pages -= TLBI_RANGE_PAGES(num, scale);
+	}
+}
+
+void xlat_arch_tlbi_va_range(uintptr_t va, size_t size, int xlat_regime)
+{
+	unsigned long pages = (unsigned long)((size + PAGE_SIZE - 1U) >>
+					      PAGE_SIZE_SHIFT);
+
+	assert(IS_PAGE_ALIGNED(va));
+
+	/*
+	 * Ensure the translation table writes have drained into memory before
+	 * invalidating the TLB entries.
+	 */
+	dsbishst();
+
+	if (is_feat_tlbirange_present()) {
+		xlat_arch_tlbi_range(va, pages, xlat_regime);
+		return;
+	}
+
+	if (pages <= XLAT_TLBI_VA_MAX_PAGES) {
+		for (; pages != 0UL; pages--) {
+			xlat_arch_tlbi_page(va, xlat_regime);
+			va += PAGE_SIZE;
+		}
+		return;
+	}
+
+	/* Too many pages, invalidate the whole translation regime instead. */
+	if (xlat_regime == EL1_EL0_REGIME) {
+		assert(xlat_arch_current_el() >= 1U);
+		tlbivmalle1is();
+	} else if (xlat_regime == EL2_REGIME) {
+		assert(xlat_arch_current_el() >= 2U);
+		tlbialle2is();
+	} else {
+		assert(xlat_regime == EL3_REGIME);
+		assert(xlat_arch_current_el() >= 3U);
+		tlbialle3is();
+	}
+}
+
 void xlat_arch_tlbi_va_sync(void)
 {
 	/*
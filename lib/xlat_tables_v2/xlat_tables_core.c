@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2017-2021, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2017-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -36,33 +36,63 @@ static inline __attribute__((unused)) void xlat_clean_dcache_range(uintptr_t add
  * handling for it.
  */
 
+/*
+ * Free tables are kept in a list linked through their first entry, which holds
+ * the index of the next free table plus one. It is shifted so that the entry
+ * still reads as an invalid descriptor, as a table that has just been unlinked
+ * may still be walked until the TLBs are invalidated.
+ */
+#define XLAT_FREE_LINK_SHIFT	U(1)
+
 /*
  * Returns the index of the array corresponding to the specified translation
  * table.
  */
 static int xlat_table_get_index(const xlat_ctx_t *ctx, const uint64_t *table)
 {
-	for (int i = 0; i < ctx->tables_num; i++)
-		if (ctx->tables[i] == table)
-			return i;
+	uintptr_t idx = ((uintptr_t)table - (uintptr_t)ctx->tables) /
+			XLAT_TABLE_SIZE;
 
 	/*
 	 * Maybe we were asked to get the index of the base level table, which
 	 * should never happen.
 	 */
-	assert(false);
+	assert((idx < (uintptr_t)ctx->tables_num) &&
+	       (ctx->tables[idx] == table));
+
+	return (int)idx;
+}
+
+/* Adds a translation table that no longer maps any region to the free list. */
+static void xlat_table_free(xlat_ctx_t *ctx, uint64_t *table)
+{
+	int idx = xlat_table_get_index(ctx, table);
 
-	return -1;
+	assert(ctx->tables_mapped_regions[idx] == 0);
+
+	table[0] = (uint64_t)(ctx->free_table + 1) << XLAT_FREE_LINK_SHIFT;
+	ctx->free_table = idx;
 }
 
-/* Returns a pointer to an empty translation table. */
-static uint64_t *xlat_table_get_empty(const xlat_ctx_t *ctx)
+/*
+ * Returns a pointer to an empty translation table. Tables freed while unmapping
+ * a region must only be reused after the TLBs have been invalidated, which the
+ * functions that unmap regions do before returning.
+ */
+static uint64_t *xlat_table_get_empty(xlat_ctx_t *ctx)
 {
-	for (int i = 0; i < ctx->tables_num; i++)
-		if (ctx->tables_mapped_regions[i] == 0)
-			return ctx->tables[i];
+	uint64_t *table;
 
-	return NULL;
+	if (ctx->free_table < 0)
+		return NULL;
+
+	table = ctx->tables[ctx->free_table];
+	assert(ctx->tables_mapped_regions[ctx->free_table] == 0);
+
+	ctx->free_table = (int)(table[0] >> XLAT_FREE_LINK_SHIFT) - 1;
+	table[0] = INVALID_DESC;
+
+	return table;
 }
 
 /* Increments region count for a given table. */
@@ -352,7 +382,9 @@ static action_t xlat_tables_unmap_region_action(const mmap_region_t *mm,
 }
 /*
  * Recursive function that writes to the translation tables and unmaps the
- * specified region.
+ * specified region. The TLB entries of the region are not invalidated, the
+ * caller must do it with xlat_arch_tlbi_va_range() and
+ * xlat_arch_tlbi_va_sync() once all the regions it removes are unmapped.
  */
 static void xlat_tables_unmap_region(xlat_ctx_t *ctx, mmap_region_t *mm,
 				     const uintptr_t table_base_va,
@@ -389,7 +421,6 @@ static void xlat_tables_unmap_region(xlat_ctx_t *ctx, mmap_region_t *mm,
 		if (action == ACTION_WRITE_BLOCK_ENTRY) {
 
 			table_base[table_idx] = INVALID_DESC;
-			xlat_arch_tlbi_va(table_idx_va, ctx->xlat_regime);
 
 		} else if (action == ACTION_RECURSE_INTO_TABLE) {
 
@@ -408,8 +439,7 @@ static void xlat_tables_unmap_region(xlat_ctx_t *ctx, mmap_region_t *mm,
 			 */
 			if (xlat_table_is_empty(ctx, subtable)) {
 				table_base[table_idx] = INVALID_DESC;
-				xlat_arch_tlbi_va(table_idx_va,
-						  ctx->xlat_regime);
+				xlat_table_free(ctx, subtable);
 			}
 
 		} else {
@@ -949,7 +979,12 @@ void mmap_add_ctx(xlat_ctx_t *ctx, const mmap_region_t *mm)
 
 #if PLAT_XLAT_TABLES_DYNAMIC
 
-int mmap_add_dynamic_region_ctx(xlat_ctx_t *ctx, mmap_region_t *mm)
+/*
+ * Adds a dynamic region and maps it if the translation tables are initialized.
+ * The caller must make sure that the new descriptors are written to memory
+ * with dsbishst() before the region is used.
+ */
+static int mmap_add_dynamic_region_nosync(xlat_ctx_t *ctx, mmap_region_t *mm)
 {
 	mmap_region_t *mm_cursor = ctx->mmap;
 	const mmap_region_t *mm_last = mm_cursor + ctx->mmap_num;
@@ -1037,16 +1072,11 @@ int mmap_add_dynamic_region_ctx(xlat_ctx_t *ctx, mmap_region_t *mm)
 			xlat_clean_dcache_range((uintptr_t)ctx->base_table,
 				ctx->base_table_entries * sizeof(uint64_t));
 #endif
+			xlat_arch_tlbi_va_range(unmap_mm.base_va, unmap_mm.size,
+						ctx->xlat_regime);
+			xlat_arch_tlbi_va_sync();
 			return -ENOMEM;
 		}
-
-		/*
-		 * Make sure that all entries are written to the memory. There
-		 * is no need to invalidate entries when mapping dynamic regions
-		 * because new table/block/page descriptors only replace old
-		 * invalid descriptors, that aren't TLB cached.
-		 */
-		dsbishst();
 	}
 
 	if (end_pa > ctx->max_pa)
@@ -1057,6 +1087,48 @@ int mmap_add_dynamic_region_ctx(xlat_ctx_t *ctx, mmap_region_t *mm)
 	return 0;
 }
 
+int mmap_add_dynamic_region_ctx(xlat_ctx_t *ctx, mmap_region_t *mm)
+{
+	int ret = mmap_add_dynamic_region_nosync(ctx, mm);
+
+	/*
+	 * Make sure that all entries are written to the memory. There is no
+	 * need to invalidate entries when mapping dynamic regions because new
+	 * table/block/page descriptors only replace old invalid descriptors,
+	 * that aren't TLB cached.
+	 */
+	if ((ret == 0) && ctx->initialized)
+		dsbishst();
+
+	return ret;
+}
+
+/*
+ * Adds an array of 'count' dynamic regions. Either all of them are added or,
+ * on error, none of them. The new descriptors are written to memory once, at
+ * the end.
+ */
+int mmap_add_dynamic_regions_ctx(xlat_ctx_t *ctx, mmap_region_t *mm,
+				 unsigned int count)
+{
+	unsigned int i;
+	int ret;
+
+	for (i = 0U; i < count; i++) {
+		ret = mmap_add_dynamic_region_nosync(ctx, &mm[i]);
+		if (ret != 0) {
+			/* Undo the regions added so far */
+			(void)mmap_remove_dynamic_regions_ctx(ctx, mm, i);
+			return ret;
+		}
+	}
+
+	if (ctx->initialized)
+		dsbishst();
+
+	return 0;
+}
+
 int mmap_add_dynamic_region_alloc_va_ctx(xlat_ctx_t *ctx, mmap_region_t *mm)
 {
 	mm->base_va = ctx->max_va + 1UL;
@@ -1075,21 +1147,18 @@ int mmap_add_dynamic_region_alloc_va_ctx(xlat_ctx_t *ctx, mmap_region_t *mm)
 }
 
 /*
- * Removes the region with given base Virtual Address and size from the given
- * context.
+ * Finds the dynamic region with given base Virtual Address and size in the
+ * mmap array of the given context.
  *
  * Returns:
- *        0: Success.
- *   EINVAL: Invalid values were used as arguments (region not found).
- *    EPERM: Tried to remove a static region.
+ *        0: Success, the region is returned in 'mm_found'.
+ *   EINVAL: The region wasn't found.
+ *    EPERM: The region is static.
  */
-int mmap_remove_dynamic_region_ctx(xlat_ctx_t *ctx, uintptr_t base_va,
-				   size_t size)
+static int mmap_find_dynamic_region(const xlat_ctx_t *ctx, uintptr_t base_va,
+				    size_t size, mmap_region_t **mm_found)
 {
 	mmap_region_t *mm = ctx->mmap;
-	const mmap_region_t *mm_last = mm + ctx->mmap_num;
-	int update_max_va_needed = 0;
-	int update_max_pa_needed = 0;
 
 	/* Check sanity of mmap array. */
 	assert(mm[ctx->mmap_num].size == 0U);
@@ -1108,24 +1177,28 @@ int mmap_remove_dynamic_region_ctx(xlat_ctx_t *ctx, uintptr_t base_va,
 	if ((mm->attr & MT_DYNAMIC) == 0U)
 		return -EPERM;
 
+	*mm_found = mm;
+
+	return 0;
+}
+
+/*
+ * Removes a region, that has already been unmapped, from the mmap array and
+ * updates the max VA and PA of the context.
+ */
+static void mmap_remove_dynamic_region_entry(xlat_ctx_t *ctx,
+					     mmap_region_t *mm)
+{
+	const mmap_region_t *mm_last = ctx->mmap + ctx->mmap_num;
+	int update_max_va_needed = 0;
+	int update_max_pa_needed = 0;
+
 	/* Check if this region is using the top VAs or PAs. */
 	if ((mm->base_va + mm->size - 1U) == ctx->max_va)
 		update_max_va_needed = 1;
 	if ((mm->base_pa + mm->size - 1U) == ctx->max_pa)
 		update_max_pa_needed = 1;
 
-	/* Update the translation tables if needed */
-	if (ctx->initialized) {
-		xlat_tables_unmap_region(ctx, mm, 0U, ctx->base_table,
-					 ctx->base_table_entries,
-					 ctx->base_level);
-#if !(HW_ASSISTED_COHERENCY || WARMBOOT_ENABLE_DCACHE_EARLY)
-		xlat_clean_dcache_range((uintptr_t)ctx->base_table,
-			ctx->base_table_entries * sizeof(uint64_t));
-#endif
-		xlat_arch_tlbi_va_sync();
-	}
-
 	/* Remove this region by moving the rest down by one place. */
 	(void)memmove(mm, mm + 1U, (uintptr_t)mm_last - (uintptr_t)mm);
 
@@ -1149,6 +1222,99 @@ int mmap_remove_dynamic_region_ctx(xlat_ctx_t *ctx, uintptr_t base_va,
 			++mm;
 		}
 	}
+}
+
+/*
+ * Removes the region with given base Virtual Address and size from the given
+ * context.
+ *
+ * Returns:
+ *        0: Success.
+ *   EINVAL: Invalid values were used as arguments (region not found).
+ *    EPERM: Tried to remove a static region.
+ */
+int mmap_remove_dynamic_region_ctx(xlat_ctx_t *ctx, uintptr_t base_va,
+				   size_t size)
+{
+	mmap_region_t mm = {
+		.base_va = base_va,
+		.size = size,
+	};
+
+	if (size == 0U)
+		return -EINVAL;
+
+	return mmap_remove_dynamic_regions_ctx(ctx, &mm, 1U);
+}
+
+/*
+ * Removes an array of 'count' dynamic regions, identified by their base VA and
+ * size, from the given context. Regions of size 0 are skipped. Nothing is
+ * removed if any of the regions can't be. The TLB entries of all the regions
+ * are invalidated together once they are all unmapped.
+ *
+ * Returns the same values as mmap_remove_dynamic_region_ctx().
+ */
+int mmap_remove_dynamic_regions_ctx(xlat_ctx_t *ctx, const mmap_region_t *mm,
+				    unsigned int count)
+{
+	mmap_region_t *mm_found;
+	unsigned int i, j;
+	int ret;
+
+	/* Check all the regions first, so that none is removed on error */
+	for (i = 0U; i < count; i++) {
+		if (mm[i].size == 0U)
+			continue;
+
+		ret = mmap_find_dynamic_region(ctx, mm[i].base_va, mm[i].size,
+					       &mm_found);
+		if (ret != 0)
+			return ret;
+
+		/* The same region can't be removed twice */
+		for (j = 0U; j < i; j++) {
+			if ((mm[j].base_va == mm[i].base_va) &&
+			    (mm[j].size == mm[i].size))
+				return -EINVAL;
+		}
+	}
+
+	/* Update the translation tables if needed */
+	if (ctx->initialized) {
+		for (i = 0U; i < count; i++) {
+			if (mm[i].size == 0U)
+				continue;
+
+			(void)mmap_find_dynamic_region(ctx, mm[i].base_va,
+						       mm[i].size, &mm_found);
+			xlat_tables_unmap_region(ctx, mm_found, 0U,
+						 ctx->base_table,
+						 ctx->base_table_entries,
+						 ctx->base_level);
+		}
+#if !(HW_ASSISTED_COHERENCY || WARMBOOT_ENABLE_DCACHE_EARLY)
+		xlat_clean_dcache_range((uintptr_t)ctx->base_table,
+			ctx->base_table_entries * sizeof(uint64_t));
+#endif
+		for (i = 0U; i < count; i++) {
+			if (mm[i].size != 0U) {
+				xlat_arch_tlbi_va_range(mm[i].base_va,
+							mm[i].size,
+							ctx->xlat_regime);
+			}
+		}
+		xlat_arch_tlbi_va_sync();
+	}
+
+	for (i = 0U; i < count; i++) {
+		if (mm[i].size == 0U)
+			continue;
+
+		(void)mmap_find_dynamic_region(ctx, mm[i].base_va, mm[i].size,
+					       &mm_found);
+		mmap_remove_dynamic_region_entry(ctx, mm_found);
+	}
 
 	return 0;
 }
@@ -1216,6 +1382,13 @@ void __init init_xlat_tables_ctx(xlat_ctx_t *ctx)
 			ctx->tables[j][i] = INVALID_DESC;
 	}
 
+#if PLAT_XLAT_TABLES_DYNAMIC
+	/* Put all the tables in the free list, to be used in order. */
+	ctx->free_table = -1;
+	for (int j = ctx->tables_num - 1; j >= 0; j--)
+		xlat_table_free(ctx, ctx->tables[j]);
+#endif
+
 	while (mm->size != 0U) {
 		uintptr_t end_va = xlat_tables_map_region(ctx, mm, 0U,
 				ctx->base_table, ctx->base_table_entries,
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2017-2021, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2017-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -63,8 +63,22 @@ uint64_t xlat_arch_regime_get_xn_desc(int xlat_regime);
 void xlat_arch_tlbi_va(uintptr_t va, int xlat_regime);
 
 /*
- * This function has to be called at the end of any code that uses the function
- * xlat_arch_tlbi_va().
+ * Invalidate all TLB entries that match the virtual addresses of the given
+ * range, with the same scope as xlat_arch_tlbi_va(). The range TLBI operations
+ * of FEAT_TLBIRANGE are used when the CPU implements them. Otherwise the range
+ * is invalidated page by page, unless it holds more than
+ * XLAT_TLBI_VA_MAX_PAGES pages, in which case all the TLB entries of the
+ * translation regime are invalidated instead.
+ */
+#ifndef XLAT_TLBI_VA_MAX_PAGES
+#define XLAT_TLBI_VA_MAX_PAGES	U(64)
+#endif
+
+void xlat_arch_tlbi_va_range(uintptr_t va, size_t size, int xlat_regime);
+
+/*
+ * This function has to be called at the end of any code that uses the
+ * functions xlat_arch_tlbi_va() or xlat_arch_tlbi_va_range().
  */
 void xlat_arch_tlbi_va_sync(void);
 
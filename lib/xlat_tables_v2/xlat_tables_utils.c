@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2017-2021, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2017-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -263,11 +263,19 @@ void xlat_tables_print(xlat_ctx_t *ctx)
 #endif /* LOG_LEVEL >= LOG_LEVEL_VERBOSE */
 
 /*
- * Do a translation table walk to find the block or page descriptor that maps
- * virtual_addr.
+ * Bit 0 of a descriptor marks it as valid. The other bits of a descriptor with
+ * bit 0 clear are ignored by the hardware.
+ */
+#define XLAT_DESC_VALID_BIT	ULL(1)
+
+/*
+ * Do a translation table walk down to the descriptor that maps virtual_addr,
+ * or that would map it. The walk stops at the first descriptor that isn't a
+ * table descriptor, even if it is invalid.
  *
  * On success, return the address of the descriptor within the translation
- * table. Its lookup level is stored in '*out_level'.
+ * table. Its lookup level is stored in '*out_level' and the number of entries
+ * of its table from it to the end of the table in '*out_entries'.
  * On error, return NULL.
  *
  * xlat_table_base
@@ -277,11 +285,12 @@ void xlat_tables_print(xlat_ctx_t *ctx)
  * virt_addr_space_size
  *   Size in bytes of the virtual address space.
  */
-static uint64_t *find_xlat_table_entry(uintptr_t virtual_addr,
-				       void *xlat_table_base,
-				       unsigned int xlat_table_base_entries,
-				       unsigned long long virt_addr_space_size,
-				       unsigned int *out_level)
+static uint64_t *xlat_table_walk(uintptr_t virtual_addr,
+				 void *xlat_table_base,
+				 unsigned int xlat_table_base_entries,
+				 unsigned long long virt_addr_space_size,
+				 unsigned int *out_level,
+				 unsigned int *out_entries)
 {
 	unsigned int start_level;
 	uint64_t *table;
@@ -295,7 +304,7 @@ static uint64_t *find_xlat_table_entry(uintptr_t virtual_addr,
 	for (unsigned int level = start_level;
 	     level <= XLAT_TABLE_LEVEL_MAX;
 	     ++level) {
-		uint64_t idx, desc, desc_type;
+		uint64_t idx, desc;
 
 		idx = XLAT_TABLE_IDX(virtual_addr, level);
 		if (idx >= entries) {
@@ -305,29 +314,14 @@ static uint64_t *find_xlat_table_entry(uintptr_t virtual_addr,
 		}
 
 		desc = table[idx];
-		desc_type = desc & DESC_MASK;
 
-		if (desc_type == INVALID_DESC) {
-			VERBOSE("Invalid entry (memory not mapped)\n");
-			return NULL;
-		}
-
-		if (level == XLAT_TABLE_LEVEL_MAX) {
-			/*
-			 * Only page descriptors allowed at the final lookup
-			 * level.
-			 */
-			assert(desc_type == PAGE_DESC);
+		if ((level == XLAT_TABLE_LEVEL_MAX) ||
+		    ((desc & DESC_MASK) != TABLE_DESC)) {
 			*out_level = level;
+			*out_entries = entries - (unsigned int)idx;
 			return &table[idx];
 		}
 
-		if (desc_type == BLOCK_DESC) {
-			*out_level = level;
-			return &table[idx];
-		}
-
-		assert(desc_type == TABLE_DESC);
 		table = (uint64_t *)(uintptr_t)(desc & TABLE_ADDR_MASK);
 		entries = XLAT_TABLE_ENTRIES;
 	}
@@ -341,6 +335,90 @@ static uint64_t *find_xlat_table_entry(uintptr_t virtual_addr,
 	return NULL;
 }
 
+/*
+ * Do a translation table walk to find the block or page descriptor that maps
+ * virtual_addr.
+ *
+ * On success, return the address of the descriptor within the translation
+ * table. Its lookup level is stored in '*out_level'.
+ * On error, return NULL.
+ */
+static uint64_t *find_xlat_table_entry(uintptr_t virtual_addr,
+				       void *xlat_table_base,
+				       unsigned int xlat_table_base_entries,
+				       unsigned long long virt_addr_space_size,
+				       unsigned int *out_level)
+{
+	uint64_t *entry;
+	uint64_t desc_type;
+	unsigned int entries;
+
+	entry = xlat_table_walk(virtual_addr, xlat_table_base,
+				xlat_table_base_entries, virt_addr_space_size,
+				out_level, &entries);
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	desc_type = *entry & DESC_MASK;
+
+	if (desc_type == INVALID_DESC) {
+		VERBOSE("Invalid entry (memory not mapped)\n");
+		return NULL;
+	}
+
+	/* Only page descriptors allowed at the final lookup level. */
+	assert((*out_level != XLAT_TABLE_LEVEL_MAX) ||
+	       (desc_type == PAGE_DESC));
+	assert((*out_level == XLAT_TABLE_LEVEL_MAX) ||
+	       (desc_type == BLOCK_DESC));
+
+	return entry;
+}
+
+/* Returns the MT_* attributes of a block or page descriptor. */
+static uint32_t xlat_desc_get_attributes(const xlat_ctx_t *ctx, uint64_t desc)
+{
+	uint32_t attributes = 0U;
+
+	uint64_t attr_index = (desc >> ATTR_INDEX_SHIFT) & ATTR_INDEX_MASK;
+
+	if (attr_index == ATTR_IWBWA_OWBWA_NTR_INDEX) {
+		attributes |= MT_MEMORY;
+	} else if (attr_index == ATTR_NON_CACHEABLE_INDEX) {
+		attributes |= MT_NON_CACHEABLE;
+	} else {
+		assert(attr_index == ATTR_DEVICE_INDEX);
+		attributes |= MT_DEVICE;
+	}
+
+	uint64_t ap2_bit = (desc >> AP2_SHIFT) & 1U;
+
+	if (ap2_bit == AP2_RW)
+		attributes |= MT_RW;
+
+	if (ctx->xlat_regime == EL1_EL0_REGIME) {
+		uint64_t ap1_bit = (desc >> AP1_SHIFT) & 1U;
+
+		if (ap1_bit == AP1_ACCESS_UNPRIVILEGED)
+			attributes |= MT_USER;
+	}
+
+	uint64_t ns_bit = (desc >> NS_SHIFT) & 1U;
+
+	if (ns_bit == 1U)
+		attributes |= MT_NS;
+
+	uint64_t xn_mask = xlat_arch_regime_get_xn_desc(ctx->xlat_regime);
+
+	if ((desc & xn_mask) == xn_mask) {
+		attributes |= MT_EXECUTE_NEVER;
+	} else {
+		assert((desc & xn_mask) == 0U);
+	}
+
+	return attributes;
+}
 
 static int xlat_get_mem_attributes_internal(const xlat_ctx_t *ctx,
 		uintptr_t base_va, uint32_t *attributes, uint64_t **table_entry,
@@ -394,61 +472,102 @@ static int xlat_get_mem_attributes_internal(const xlat_ctx_t *ctx,
 #endif /* LOG_LEVEL >= LOG_LEVEL_VERBOSE */
 
 	assert(attributes != NULL);
-	*attributes = 0U;
+	*attributes = xlat_desc_get_attributes(ctx, desc);
 
-	uint64_t attr_index = (desc >> ATTR_INDEX_SHIFT) & ATTR_INDEX_MASK;
+	return 0;
+}
 
-	if (attr_index == ATTR_IWBWA_OWBWA_NTR_INDEX) {
-		*attributes |= MT_MEMORY;
-	} else if (attr_index == ATTR_NON_CACHEABLE_INDEX) {
-		*attributes |= MT_NON_CACHEABLE;
-	} else {
-		assert(attr_index == ATTR_DEVICE_INDEX);
-		*attributes |= MT_DEVICE;
-	}
 
-	uint64_t ap2_bit = (desc >> AP2_SHIFT) & 1U;
+int xlat_get_mem_attributes_ctx(const xlat_ctx_t *ctx, uintptr_t base_va,
+				uint32_t *attr)
+{
+	return xlat_get_mem_attributes_internal(ctx, base_va, attr,
+				NULL, NULL, NULL);
+}
 
-	if (ap2_bit == AP2_RW)
-		*attributes |= MT_RW;
+/*
+ * Check that the range of 'size' bytes from 'base_va' is fully mapped with
+ * page descriptors or with block descriptors that are fully inside the range,
+ * and that device memory isn't made executable. The range is walked one run
+ * of consecutive descriptors of a translation table at a time.
+ */
+static int xlat_change_mem_attributes_check(const xlat_ctx_t *ctx,
+					    uintptr_t base_va, size_t size,
+					    uint32_t attr)
+{
+	unsigned long long virt_addr_space_size =
+		(unsigned long long)ctx->va_max_address + 1U;
+	uintptr_t va = base_va;
+	size_t size_left = size;
 
-	if (ctx->xlat_regime == EL1_EL0_REGIME) {
-		uint64_t ap1_bit = (desc >> AP1_SHIFT) & 1U;
+	while (size_left != 0U) {
+		const uint64_t *entry;
+		unsigned int level, entries;
+		size_t block_size;
 
-		if (ap1_bit == AP1_ACCESS_UNPRIVILEGED)
-			*attributes |= MT_USER;
-	}
+		entry = xlat_table_walk(va, ctx->base_table,
+					ctx->base_table_entries,
+					virt_addr_space_size, &level, &entries);
+		if (entry == NULL) {
+			WARN("Address 0x%lx is not mapped.\n", va);
+			return -EINVAL;
+		}
 
-	uint64_t ns_bit = (desc >> NS_SHIFT) & 1U;
+		block_size = XLAT_BLOCK_SIZE(level);
 
-	if (ns_bit == 1U)
-		*attributes |= MT_NS;
+		for (unsigned int i = 0U;
+		     (i < entries) && (size_left != 0U); ++i) {
+			uint64_t desc = entry[i];
+			uint64_t attr_index;
 
-	uint64_t xn_mask = xlat_arch_regime_get_xn_desc(ctx->xlat_regime);
+			if ((desc & DESC_MASK) == INVALID_DESC) {
+				WARN("Address 0x%lx is not mapped.\n", va);
+				return -EINVAL;
+			}
 
-	if ((desc & xn_mask) == xn_mask) {
-		*attributes |= MT_EXECUTE_NEVER;
-	} else {
-		assert((desc & xn_mask) == 0U);
-	}
+			/* Walk down the next table from its first entry */
+			if ((level != XLAT_TABLE_LEVEL_MAX) &&
+			    ((desc & DESC_MASK) == TABLE_DESC)) {
+				break;
+			}
 
-	return 0;
-}
+			/*
+			 * Blocks can only be changed as a whole, they aren't
+			 * split into smaller ones.
+			 */
+			if (!is_aligned(va, block_size) ||
+			    (size_left < block_size)) {
+				WARN("Address 0x%lx is not mapped at the right granularity.\n",
+				     va);
+				WARN("Granularity is 0x%zx, range is not aligned to it.\n",
+				     block_size);
+				return -EINVAL;
+			}
 
+			/*
+			 * If the region type is device, it shouldn't be
+			 * executable.
+			 */
+			attr_index = (desc >> ATTR_INDEX_SHIFT) &
+				     ATTR_INDEX_MASK;
+			if ((attr_index == ATTR_DEVICE_INDEX) &&
+			    ((attr & MT_EXECUTE_NEVER) == 0U)) {
+				WARN("Setting device memory as executable at address 0x%lx.",
+				     va);
+				return -EINVAL;
+			}
 
-int xlat_get_mem_attributes_ctx(const xlat_ctx_t *ctx, uintptr_t base_va,
-				uint32_t *attr)
-{
-	return xlat_get_mem_attributes_internal(ctx, base_va, attr,
-				NULL, NULL, NULL);
-}
+			va += block_size;
+			size_left -= block_size;
+		}
+	}
 
+	return 0;
+}
 
 int xlat_change_mem_attributes_ctx(const xlat_ctx_t *ctx, uintptr_t base_va,
 				   size_t size, uint32_t attr)
 {
-	/* Note: This implementation isn't optimized. */
-
 	assert(ctx != NULL);
 	assert(ctx->initialized);
 
@@ -479,110 +598,106 @@ int xlat_change_mem_attributes_ctx(const xlat_ctx_t *ctx, uintptr_t base_va,
 		return -EINVAL;
 	}
 
-	size_t pages_count = size / PAGE_SIZE;
-
 	VERBOSE("Changing memory attributes of %zu pages starting from address 0x%lx...\n",
-		pages_count, base_va);
+		size / PAGE_SIZE, base_va);
+
+	int ret = xlat_change_mem_attributes_check(ctx, base_va, size, attr);
 
-	uintptr_t base_va_original = base_va;
+	if (ret != 0) {
+		return ret;
+	}
 
 	/*
-	 * Sanity checks.
+	 * The break-before-make sequence requires writing invalid descriptors
+	 * and making sure that the system sees the change before writing the
+	 * new descriptors. It is done once for the whole range: each
+	 * descriptor is first replaced by its new value with the valid bit
+	 * clear, the TLBs are invalidated for the whole range, then the valid
+	 * bits are set.
 	 */
-	for (unsigned int i = 0U; i < pages_count; ++i) {
-		const uint64_t *entry;
-		uint64_t desc, attr_index;
-		unsigned int level;
-
-		entry = find_xlat_table_entry(base_va,
-					      ctx->base_table,
-					      ctx->base_table_entries,
-					      virt_addr_space_size,
-					      &level);
-		if (entry == NULL) {
-			WARN("Address 0x%lx is not mapped.\n", base_va);
-			return -EINVAL;
-		}
+	uintptr_t va = base_va;
+	size_t size_left = size;
+
+	while (size_left != 0U) {
+		uint64_t *entry;
+		unsigned int level, entries, count;
+		size_t block_size;
+
+		entry = xlat_table_walk(va, ctx->base_table,
+					ctx->base_table_entries,
+					virt_addr_space_size, &level, &entries);
+		assert(entry != NULL);
+		block_size = XLAT_BLOCK_SIZE(level);
+
+		for (count = 0U; (count < entries) && (size_left != 0U);
+		     ++count) {
+			uint64_t desc = entry[count];
+			uint32_t new_attr;
+
+			if ((level != XLAT_TABLE_LEVEL_MAX) &&
+			    ((desc & DESC_MASK) == TABLE_DESC)) {
+				break;
+			}
 
-		desc = *entry;
+			/*
+			 * From attr, only MT_RO/MT_RW, MT_EXECUTE/MT_EXECUTE_NEVER
+			 * and MT_USER/MT_PRIVILEGED are taken into account. Any
+			 * other information is ignored.
+			 */
+			new_attr = xlat_desc_get_attributes(ctx, desc) &
+				   ~(MT_RW | MT_EXECUTE_NEVER | MT_USER);
+			new_attr |= attr & (MT_RW | MT_EXECUTE_NEVER | MT_USER);
 
-		/*
-		 * Check that all the required pages are mapped at page
-		 * granularity.
-		 */
-		if (((desc & DESC_MASK) != PAGE_DESC) ||
-			(level != XLAT_TABLE_LEVEL_MAX)) {
-			WARN("Address 0x%lx is not mapped at the right granularity.\n",
-			     base_va);
-			WARN("Granularity is 0x%lx, should be 0x%lx.\n",
-			     XLAT_BLOCK_SIZE(level), PAGE_SIZE);
-			return -EINVAL;
-		}
+			entry[count] = xlat_desc(ctx, new_attr,
+						 desc & TABLE_ADDR_MASK,
+						 level) & ~XLAT_DESC_VALID_BIT;
 
-		/*
-		 * If the region type is device, it shouldn't be executable.
-		 */
-		attr_index = (desc >> ATTR_INDEX_SHIFT) & ATTR_INDEX_MASK;
-		if (attr_index == ATTR_DEVICE_INDEX) {
-			if ((attr & MT_EXECUTE_NEVER) == 0U) {
-				WARN("Setting device memory as executable at address 0x%lx.",
-				     base_va);
-				return -EINVAL;
-			}
+			va += block_size;
+			size_left -= block_size;
 		}
-
-		base_va += PAGE_SIZE;
+#if !HW_ASSISTED_COHERENCY
+		clean_dcache_range((uintptr_t)entry,
+				   count * sizeof(uint64_t));
+#endif
 	}
 
-	/* Restore original value. */
-	base_va = base_va_original;
+	/* Invalidate any cached copy of the range in the TLBs. */
+	xlat_arch_tlbi_va_range(base_va, size, ctx->xlat_regime);
 
-	for (unsigned int i = 0U; i < pages_count; ++i) {
+	/* Ensure completion of the invalidation. */
+	xlat_arch_tlbi_va_sync();
 
-		uint32_t old_attr = 0U, new_attr;
-		uint64_t *entry = NULL;
-		unsigned int level = 0U;
-		unsigned long long addr_pa = 0ULL;
+	/* Make the new descriptors valid */
+	va = base_va;
+	size_left = size;
 
-		(void) xlat_get_mem_attributes_internal(ctx, base_va, &old_attr,
-					    &entry, &addr_pa, &level);
+	while (size_left != 0U) {
+		uint64_t *entry;
+		unsigned int level, entries, count;
+		size_t block_size;
 
-		/*
-		 * From attr, only MT_RO/MT_RW, MT_EXECUTE/MT_EXECUTE_NEVER and
-		 * MT_USER/MT_PRIVILEGED are taken into account. Any other
-		 * information is ignored.
-		 */
+		entry = xlat_table_walk(va, ctx->base_table,
+					ctx->base_table_entries,
+					virt_addr_space_size, &level, &entries);
+		assert(entry != NULL);
+		block_size = XLAT_BLOCK_SIZE(level);
 
-		/* Clean the old attributes so that they can be rebuilt. */
-		new_attr = old_attr & ~(MT_RW | MT_EXECUTE_NEVER | MT_USER);
-
-		/*
-		 * Update attributes, but filter out the ones this function
-		 * isn't allowed to change.
-		 */
-		new_attr |= attr & (MT_RW | MT_EXECUTE_NEVER | MT_USER);
-
-		/*
-		 * The break-before-make sequence requires writing an invalid
-		 * descriptor and making sure that the system sees the change
-		 * before writing the new descriptor.
-		 */
-		*entry = INVALID_DESC;
-#if !HW_ASSISTED_COHERENCY
-		dccvac((uintptr_t)entry);
-#endif
-		/* Invalidate any cached copy of this mapping in the TLBs. */
-		xlat_arch_tlbi_va(base_va, ctx->xlat_regime);
+		for (count = 0U; (count < entries) && (size_left != 0U);
+		     ++count) {
+			/* Valid descriptors are tables to walk down */
+			if ((entry[count] & XLAT_DESC_VALID_BIT) != 0U) {
+				break;
+			}
 
-		/* Ensure completion of the invalidation. */
-		xlat_arch_tlbi_va_sync();
+			entry[count] |= XLAT_DESC_VALID_BIT;
 
-		/* Write new descriptor */
-		*entry = xlat_desc(ctx, new_attr, addr_pa, level);
+			va += block_size;
+			size_left -= block_size;
+		}
 #if !HW_ASSISTED_COHERENCY
-		dccvac((uintptr_t)entry);
+		clean_dcache_range((uintptr_t)entry,
+				   count * sizeof(uint64_t));
 #endif
-		base_va += PAGE_SIZE;
 	}
 
 	/* Ensure that the last descriptor written is seen by the system. */
@@ -1,11 +1,12 @@
 /*
- * Copyright (c) 2018-2021, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2018-2023, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
 #include <assert.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include <common/debug.h>
@@ -102,6 +103,103 @@ int gunzip(uintptr_t *in_buf, size_t in_len, uintptr_t *out_buf,
 	return ret;
 }
 
+/* State of the decompression in progress with gunzip_stream_*() */
+static z_stream gunzip_strm;
+static bool gunzip_strm_end;
+
+static int gunzip_zret_to_errno(int zret)
+{
+	return (zret == Z_MEM_ERROR) ? -ENOMEM : -EIO;
+}
+
+/*
+ * gunzip_stream_init - start decompressing gzip data provided in chunks
+ * @out_buf: destination of decompressed output
+ * @out_len: length of out_buf
+ * @work_buf: workspace
+ * @work_len: length of workspace
+ */
+int gunzip_stream_init(uintptr_t out_buf, size_t out_len, uintptr_t work_buf,
+		       size_t work_len)
+{
+	int zret;
+
+	zalloc_start = work_buf;
+	zalloc_end = work_buf + work_len;
+	zalloc_current = zalloc_start;
+
+	memset(&gunzip_strm, 0, sizeof(gunzip_strm));
+	gunzip_strm.next_out = (typeof(gunzip_strm.next_out))out_buf;
+	gunzip_strm.avail_out = out_len;
+	gunzip_strm.zalloc = zcalloc;
+	gunzip_strm.zfree = zfree;
+	gunzip_strm.opaque = (voidpf)0;
+	gunzip_strm_end = false;
+
+	zret = inflateInit(&gunzip_strm);
+	if (zret != Z_OK) {
+		ERROR("zlib: inflate init failed (ret = %d)\n", zret);
+		return gunzip_zret_to_errno(zret);
+	}
+
+	return 0;
+}
+
+/*
+ * gunzip_stream_update - decompress the next chunk of gzip data
+ * @in_buf: chunk of compressed input
+ * @in_len: length of in_buf
+ */
+int gunzip_stream_update(uintptr_t in_buf, size_t in_len)
+{
+	int zret;
+
+	if (gunzip_strm_end) {
+		/* Ignore any trailing data after the end of the stream */
+		return 0;
+	}
+
+	gunzip_strm.next_in = (typeof(gunzip_strm.next_in))in_buf;
+	gunzip_strm.avail_in = in_len;
+
+	zret = inflate(&gunzip_strm, Z_NO_FLUSH);
+	if (zret == Z_STREAM_END) {
+		gunzip_strm_end = true;
+	} else if ((zret != Z_OK) || (gunzip_strm.avail_in != 0U)) {
+		/* Input left over means that the output buffer is full */
+		if (gunzip_strm.msg)
+			ERROR("%s\n", gunzip_strm.msg);
+		ERROR("zlib: inflate failed (ret = %d)\n", zret);
+		inflateEnd(&gunzip_strm);
+		return gunzip_zret_to_errno(zret);
+	}
+
+	return 0;
+}
+
+/*
+ * gunzip_stream_finish - complete the decompression
+ * @out_buf: upon exit, the end of output
+ */
+int gunzip_stream_finish(uintptr_t *out_buf)
+{
+	int ret = 0;
+
+	if (!gunzip_strm_end) {
+		ERROR("zlib: truncated input\n");
+		ret = -EIO;
+	}
+
+	VERBOSE("zlib: %lu byte input\n", gunzip_strm.total_in);
+	VERBOSE("zlib: %lu byte output\n", gunzip_strm.total_out);
+
+	*out_buf = (uintptr_t)gunzip_strm.next_out;
+
+	inflateEnd(&gunzip_strm);
+
+	return ret;
+}
+
 /* Wrapper function to calculate CRC
  * @crc: previous accumulated CRC
  * @buf: buffer base address
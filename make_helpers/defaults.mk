@@ -53,6 +53,10 @@ COLD_BOOT_SINGLE_CPU		:= 0
 # Makefile system will set this when compiling TF as part of a coreboot image.
 COREBOOT			:= 0
 
+# Use 8 KiB of lookup tables to compute CRC32 in software 8 bytes at a time,
+# instead of a 1 KiB table and one byte at a time. Disabled by default.
+CRC32_SLICE_BY_8		:= 0
+
 # For Chain of Trust
 CREATE_KEYS			:= 1
 
@@ -97,6 +101,12 @@ ENABLE_PSCI_STAT		:= 0
 # Flag to enable runtime instrumentation using PMF
 ENABLE_RUNTIME_INSTRUMENTATION	:= 0
 
+# Flag to enable per-SMC latency statistics using PMF
+ENABLE_SMC_LATENCY_STATS	:= 0
+
+# Flag to call runtime service leaf handlers without a full context save
+ENABLE_SMC_LEAF_HANDLERS	:= 0
+
 # Flag to enable stack corruption protection
 ENABLE_STACK_PROTECTOR		:= 0
 
@@ -150,6 +160,10 @@ HANDLE_EA_EL3_FIRST_NS		:= 0
 # Enable Handoff protocol using transfer lists
 TRANSFER_LIST			:= 0
 
+# Number of transfer list tags whose entries are cached by lookups. Disabled
+# by default.
+TRANSFER_LIST_TAG_CACHE_SIZE	:= 0
+
 # Enables support for the gcc compiler option "-mharden-sls=all".
 # By default, disables all SLS hardening.
 HARDEN_SLS			:= 0
@@ -185,6 +199,9 @@ NS_TIMER_SWITCH			:= 0
 # Include lib/libc in the final image
 OVERRIDE_LIBC			:= 0
 
+# Keep IO devices open and initialised until the end of the boot stage
+PERSISTENT_IO_DEVICES		:= 0
+
 # Build PL011 UART driver in minimal generic UART mode
 PL011_GENERIC_UART		:= 0
 
@@ -257,6 +274,10 @@ SPIN_ON_BL1_EXIT		:= 0
 # Flags to build TF with Trusted Boot support
 TRUSTED_BOARD_BOOT		:= 0
 
+# Build option to implement bakery locks as ticket locks on systems with
+# hardware-assisted coherency.
+USE_BAKERY_TICKET_LOCK		:= 0
+
 # Build option to choose whether Trusted Firmware uses Coherent memory or not.
 USE_COHERENT_MEM		:= 1
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2016-2023, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2016-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -146,12 +146,38 @@ static uintptr_t arm_sip_handler(unsigned int smc_fid,
 }
 
 
+#if ENABLE_SMC_LEAF_HANDLERS
+/*
+ * Leaf handler for the PMF timestamp reads, which only return information, see
+ * rt_svc_desc_t.
+ */
+static uintptr_t arm_sip_leaf_handler(unsigned int smc_fid,
+			u_register_t x1,
+			u_register_t x2,
+			u_register_t x3,
+			u_register_t x4,
+			void *cookie,
+			void *handle,
+			u_register_t flags)
+{
+#if ENABLE_PMF
+	if (is_pmf_fid(smc_fid)) {
+		return pmf_smc_handler(smc_fid, x1, x2, x3, x4, cookie,
+				handle, flags);
+	}
+#endif /* ENABLE_PMF */
+
+	return 0;
+}
+#endif /* ENABLE_SMC_LEAF_HANDLERS */
+
 /* Define a runtime service descriptor for fast SMC calls */
-DECLARE_RT_SVC(
+DECLARE_RT_SVC_LEAF(
 	arm_sip_svc,
 	OEN_SIP_START,
 	OEN_SIP_END,
 	SMC_TYPE_FAST,
 	arm_sip_setup,
-	arm_sip_handler
+	arm_sip_handler,
+	arm_sip_leaf_handler
 );
@@ -22,6 +22,8 @@
 #endif
 
 #if (ENABLE_RME == 1) && (defined(SPD_spmd) && SPMD_SPM_AT_SEL2 == 1)
+#define PROTECT_MEMORY_CHUNK_SIZE	UL(0x200000)
+
 static uint64_t plat_protect_memory(bool protect,
 				    bool secure_origin,
 				    const uint64_t base,
@@ -30,6 +32,7 @@ static uint64_t plat_protect_memory(bool protect,
 {
 	uint64_t ret = SMC_INVALID_PARAM;
 	uint64_t last_updated = 0;
+	uint64_t next;
 
 	if (!secure_origin) {
 		SMC_RET1(handle, SMC_UNK);
@@ -49,20 +52,27 @@ static uint64_t plat_protect_memory(bool protect,
 		/* Shall not be reached. */
 	}
 
-	for (uint64_t it = base; it < (base + size); it += PAGE_SIZE_4KB) {
+	/*
+	 * Transition the memory in 2MB aligned chunks, which never cross a GPT
+	 * L0 region boundary.
+	 */
+	for (uint64_t it = base; it < (base + size); it = next) {
+		next = MIN(round_up(it + 1U, PROTECT_MEMORY_CHUNK_SIZE),
+			   base + size);
+
 		/*
 		 * If protect is true, add memory to secure PAS.
 		 * Else unprotect it, making part of non-secure PAS.
 		 */
 		ret = protect
-			? gpt_delegate_pas(it, PAGE_SIZE_4KB,
+			? gpt_delegate_pas(it, next - it,
 					   SMC_FROM_SECURE)
-			: gpt_undelegate_pas(it, PAGE_SIZE_4KB,
+			: gpt_undelegate_pas(it, next - it,
 					     SMC_FROM_SECURE);
 
 		switch (ret) {
 		case 0:
-			last_updated = it;
+			last_updated = next - PAGE_SIZE_4KB;
 			break;
 		case -EINVAL:
 			SMC_RET2(handle, SMC_INVALID_PARAM, last_updated);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2017-2020, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2017-2024, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -28,6 +28,15 @@ static uintptr_t uniphier_mem_base = UNIPHIER_MEM_BASE;
 static unsigned int uniphier_soc = UNIPHIER_SOC_UNKNOWN;
 static int uniphier_bl2_kick_scp;
 
+#ifdef UNIPHIER_DECOMPRESS_GZIP
+/* Inflate images chunk by chunk while they are loaded, when possible */
+static const decompressor_stream_t uniphier_gunzip_stream = {
+	.init = gunzip_stream_init,
+	.update = gunzip_stream_update,
+	.finish = gunzip_stream_finish,
+};
+#endif
+
 void bl2_el3_early_platform_setup(u_register_t x0, u_register_t x1,
 				  u_register_t x2, u_register_t x3)
 {
@@ -121,6 +130,7 @@ void bl2_plat_preload_setup(void)
 		plat_error_handler(ret);
 
 	image_decompress_init(buf_base, UNIPHIER_IMAGE_BUF_SIZE, gunzip);
+	image_decompress_init_stream(&uniphier_gunzip_stream);
 #endif
 
 	uniphier_init_image_descs(uniphier_mem_base);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2018-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -168,12 +168,35 @@ static uintptr_t arm_arch_svc_smc_handler(uint32_t smc_fid,
 	}
 }
 
+#if ENABLE_SMC_LEAF_HANDLERS
+/*
+ * Leaf handler for the calls that only return information, see rt_svc_desc_t.
+ */
+static uintptr_t arm_arch_svc_leaf_handler(uint32_t smc_fid,
+	u_register_t x1,
+	u_register_t x2,
+	u_register_t x3,
+	u_register_t x4,
+	void *cookie,
+	void *handle,
+	u_register_t flags)
+{
+	if ((smc_fid == SMCCC_VERSION) || (smc_fid == SMCCC_ARCH_FEATURES)) {
+		return arm_arch_svc_smc_handler(smc_fid, x1, x2, x3, x4, cookie,
+						handle, flags);
+	}
+
+	return 0;
+}
+#endif /* ENABLE_SMC_LEAF_HANDLERS */
+
 /* Register Standard Service Calls as runtime service */
-DECLARE_RT_SVC(
+DECLARE_RT_SVC_LEAF(
 		arm_arch_svc,
 		OEN_ARM_START,
 		OEN_ARM_END,
 		SMC_TYPE_FAST,
 		NULL,
-		arm_arch_svc_smc_handler
+		arm_arch_svc_smc_handler,
+		arm_arch_svc_leaf_handler
 );
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022 Arm Limited. All rights reserved.
+ * Copyright (c) 2022-2024 Arm Limited. All rights reserved.
  *
  * SPDX-License-Identifier:    BSD-3-Clause
  *
@@ -40,7 +40,7 @@ static int drtm_event_log_measure_and_record(uintptr_t data_base,
 					     unsigned int pcr)
 {
 	int rc;
-	unsigned char hash_data[CRYPTO_MD_MAX_SIZE];
+	unsigned char hash_data[EVENT_LOG_HASH_BUF_SIZE];
 	event_log_metadata_t metadata = {0};
 
 	metadata.name = event_name;
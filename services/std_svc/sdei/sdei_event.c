@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2017-2022, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2017-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -12,6 +12,75 @@
 
 #define MAP_OFF(_map, _mapping) ((_map) - (_mapping)->map)
 
+/*
+ * Offset plus one of the map bound to each interrupt ID below
+ * PLAT_SDEI_INTR_TABLE_SIZE, or zero if there is none. SGIs and PPIs are bound
+ * to private maps and SPIs to shared maps.
+ */
+static uint16_t sdei_intr_table[PLAT_SDEI_INTR_TABLE_SIZE];
+
+static const sdei_mapping_t *intr_to_mapping(unsigned int intr_num)
+{
+	return (plat_ic_is_spi(intr_num) != 0) ? SDEI_SHARED_MAPPING() :
+		SDEI_PRIVATE_MAPPING();
+}
+
+/*
+ * Record 'map' as the map bound to its interrupt. An interrupt that already has
+ * a map keeps it, as the lookup returns the first matching map.
+ */
+void sdei_intr_table_add(sdei_ev_map_t *map)
+{
+	const sdei_mapping_t *mapping;
+
+	if ((map->intr == SDEI_DYN_IRQ) ||
+	    (map->intr >= PLAT_SDEI_INTR_TABLE_SIZE)) {
+		return;
+	}
+
+	mapping = is_event_private(map) ? SDEI_PRIVATE_MAPPING() :
+		SDEI_SHARED_MAPPING();
+	if ((mapping != intr_to_mapping(map->intr)) ||
+	    (sdei_intr_table[map->intr] != 0U)) {
+		return;
+	}
+
+	sdei_intr_table[map->intr] = (uint16_t)(MAP_OFF(map, mapping) + 1);
+}
+
+/* Forget the map bound to the interrupt of 'map', before it is released */
+void sdei_intr_table_remove(sdei_ev_map_t *map)
+{
+	const sdei_mapping_t *mapping;
+
+	if ((map->intr == SDEI_DYN_IRQ) ||
+	    (map->intr >= PLAT_SDEI_INTR_TABLE_SIZE)) {
+		return;
+	}
+
+	mapping = intr_to_mapping(map->intr);
+	if ((sdei_intr_table[map->intr] != 0U) &&
+	    (&mapping->map[sdei_intr_table[map->intr] - 1U] == map)) {
+		sdei_intr_table[map->intr] = 0U;
+	}
+}
+
+/* Build the interrupt lookup table from the platform mappings */
+void sdei_intr_table_init(void)
+{
+	const sdei_mapping_t *mapping;
+	sdei_ev_map_t *map;
+	unsigned int i, j;
+
+	for_each_mapping_type(i, mapping) {
+		assert(mapping->num_maps < UINT16_MAX);
+
+		iterate_mapping(mapping, j, map) {
+			sdei_intr_table_add(map);
+		}
+	}
+}
+
 /*
  * Get SDEI entry with the given mapping: on success, returns pointer to SDEI
  * entry. On error, returns NULL.
@@ -61,12 +130,27 @@ sdei_ev_map_t *find_event_map_by_intr(unsigned int intr_num, bool shared)
 	sdei_ev_map_t *map;
 	unsigned int i;
 
+	mapping = shared ? SDEI_SHARED_MAPPING() : SDEI_PRIVATE_MAPPING();
+
 	/*
-	 * Look for a match in private and shared mappings, as requested. This
-	 * is a linear search. However, if the mappings are required to be
-	 * sorted, for large maps, we could consider binary search.
+	 * Bound interrupts with small IDs are found through the lookup table.
+	 * Free dynamic maps and interrupts outside the table are searched for
+	 * linearly, as is the table entry of an interrupt looked up in the
+	 * other mapping type.
 	 */
-	mapping = shared ? SDEI_SHARED_MAPPING() : SDEI_PRIVATE_MAPPING();
+	if ((intr_num != SDEI_DYN_IRQ) &&
+	    (intr_num < PLAT_SDEI_INTR_TABLE_SIZE) &&
+	    (mapping == intr_to_mapping(intr_num))) {
+		if (sdei_intr_table[intr_num] == 0U) {
+			return NULL;
+		}
+
+		map = &mapping->map[sdei_intr_table[intr_num] - 1U];
+		if (map->intr == intr_num) {
+			return map;
+		}
+	}
+
 	iterate_mapping(mapping, i, map) {
 		if (map->intr == intr_num)
 			return map;
@@ -83,17 +167,28 @@ sdei_ev_map_t *find_event_map(int ev_num)
 {
 	const sdei_mapping_t *mapping;
 	sdei_ev_map_t *map;
-	unsigned int i, j;
+	unsigned int i;
+	size_t low, high, mid;
 
 	/*
-	 * Iterate through mappings to find a match. This is a linear search.
-	 * However, if the mappings are required to be sorted, for large maps,
-	 * we could consider binary search.
+	 * The mappings are sorted in the increasing order of event number, so
+	 * a binary search is done in each of them.
 	 */
 	for_each_mapping_type(i, mapping) {
-		iterate_mapping(mapping, j, map) {
+		low = 0U;
+		high = mapping->num_maps;
+		while (low < high) {
+			mid = low + ((high - low) / 2U);
+			map = &mapping->map[mid];
+
 			if (map->ev_num == ev_num)
 				return map;
+
+			if (map->ev_num < ev_num) {
+				low = mid + 1U;
+			} else {
+				high = mid;
+			}
 		}
 	}
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2017-2019, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2017-2024, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -34,6 +34,15 @@
 # error Platform must define SDEI normal priority value
 #endif
 
+/*
+ * Interrupts with an ID below this value are mapped to their SDEI event through
+ * a lookup table. The default covers all SGIs, PPIs and SPIs. Platforms that
+ * only bind low interrupt IDs can use a smaller value to save memory.
+ */
+#ifndef PLAT_SDEI_INTR_TABLE_SIZE
+# define PLAT_SDEI_INTR_TABLE_SIZE	U(1020)
+#endif
+
 /* Output SDEI logs as verbose */
 #define SDEI_LOG(...)	VERBOSE("SDEI: " __VA_ARGS__)
 
@@ -230,6 +239,9 @@ extern sdei_entry_t sdei_shared_event_table[];
 
 void init_sdei_state(void);
 
+void sdei_intr_table_init(void);
+void sdei_intr_table_add(sdei_ev_map_t *map);
+void sdei_intr_table_remove(sdei_ev_map_t *map);
 sdei_ev_map_t *find_event_map_by_intr(unsigned int intr_num, bool shared);
 sdei_ev_map_t *find_event_map(int ev_num);
 sdei_entry_t *get_event_entry(sdei_ev_map_t *map);
@@ -797,31 +797,24 @@ static uint64_t rxtx_map_handler(uint32_t smc_fid,
 		goto err;
 	}
 
-	/* memmap the TX buffer as read only. */
-	ret = mmap_add_dynamic_region(tx_address, /* PA */
-			tx_address, /* VA */
-			buf_size, /* size */
-			mem_atts | MT_RO_DATA); /* attrs */
+	/*
+	 * memmap the TX buffer as read only and the RX buffer as read write.
+	 * Either both are mapped or neither is.
+	 */
+	mmap_region_t rxtx_regions[] = {
+		MAP_REGION(tx_address, tx_address, buf_size,
+			   mem_atts | MT_RO_DATA),
+		MAP_REGION(rx_address, rx_address, buf_size,
+			   mem_atts | MT_RW_DATA),
+	};
+
+	ret = mmap_add_dynamic_regions(rxtx_regions,
+				       ARRAY_SIZE(rxtx_regions));
 	if (ret != 0) {
 		/* Return the correct error code. */
 		error_code = (ret == -ENOMEM) ? FFA_ERROR_NO_MEMORY :
 						FFA_ERROR_INVALID_PARAMETER;
-		WARN("Unable to map TX buffer: %d\n", error_code);
-		goto err;
-	}
-
-	/* memmap the RX buffer as read write. */
-	ret = mmap_add_dynamic_region(rx_address, /* PA */
-			rx_address, /* VA */
-			buf_size, /* size */
-			mem_atts | MT_RW_DATA); /* attrs */
-
-	if (ret != 0) {
-		error_code = (ret == -ENOMEM) ? FFA_ERROR_NO_MEMORY :
-						FFA_ERROR_INVALID_PARAMETER;
-		WARN("Unable to map RX buffer: %d\n", error_code);
-		/* Unmap the TX buffer again. */
-		mmap_remove_dynamic_region(tx_address, buf_size);
+		WARN("Unable to map RX/TX buffers: %d\n", error_code);
 		goto err;
 	}
 
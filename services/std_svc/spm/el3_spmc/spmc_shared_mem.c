@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2022-2024, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -24,12 +24,23 @@
  * @desc_filled:    Size of @desc already received.
  * @in_use:         Number of clients that have called ffa_mem_retrieve_req
  *                  without a matching ffa_mem_relinquish call.
+ * @view_ffa_version:
+ *                  0 for an object holding a descriptor passed in
+ *                  ffa_mem_share. Otherwise the object is a cached copy of
+ *                  the descriptor of the object with the same handle,
+ *                  converted to the format of this FF-A version.
+ * @cons_checked:   Number of constituent memory region descriptors in @desc
+ *                  already validated while receiving it.
+ * @page_count:     Sum of the page counts of these descriptors.
  * @desc:           FF-A memory region descriptor passed in ffa_mem_share.
  */
 struct spmc_shmem_obj {
 	size_t desc_size;
 	size_t desc_filled;
 	size_t in_use;
+	uint32_t view_ffa_version;
+	uint32_t cons_checked;
+	uint64_t page_count;
 	struct ffa_mtd desc;
 };
 
@@ -57,6 +68,133 @@ static size_t spmc_shmem_obj_size(size_t desc_size)
 	return desc_size + offsetof(struct spmc_shmem_obj, desc);
 }
 
+/**
+ * spmc_shmem_index_hash - Get the first slot of a handle in the index.
+ * @handle:     Handle of the object.
+ *
+ * Return: Slot of @state->index to start probing from.
+ */
+static unsigned int spmc_shmem_index_hash(uint64_t handle)
+{
+	/* Handles are allocated sequentially, fold in the high bits. */
+	return (unsigned int)(handle ^ (handle >> 32)) &
+		(SPMC_SHMEM_INDEX_SIZE - 1U);
+}
+
+/**
+ * spmc_shmem_index_add - Add an object to the handle index.
+ * @state:      Global state.
+ * @obj:        Object with its final handle.
+ *
+ * Objects are indexed by handle and view version, so an object and its cached
+ * views are found separately. If another object already has the same key, the
+ * first one in @state->data is kept, as spmc_shmem_obj_lookup_view() would find
+ * it when walking @state->data.
+ * If the index gets too full to stay fast, it is abandoned until the next
+ * rebuild.
+ */
+static void spmc_shmem_index_add(struct spmc_shmem_obj_state *state,
+				 struct spmc_shmem_obj *obj)
+{
+	unsigned int slot = spmc_shmem_index_hash(obj->desc.handle);
+	size_t offset = (uint8_t *)obj - state->data;
+
+	if (state->index_full) {
+		return;
+	}
+
+	if (state->index_count >= ((SPMC_SHMEM_INDEX_SIZE / 4U) * 3U)) {
+		VERBOSE("%s: index full, falling back to linear lookups\n",
+			__func__);
+		state->index_full = true;
+		return;
+	}
+
+	while (state->index[slot] != 0U) {
+		struct spmc_shmem_obj *other = (struct spmc_shmem_obj *)
+			(state->data + state->index[slot] - 1U);
+
+		if ((other->desc.handle == obj->desc.handle) &&
+		    (other->view_ffa_version == obj->view_ffa_version)) {
+			return;
+		}
+		slot = (slot + 1U) & (SPMC_SHMEM_INDEX_SIZE - 1U);
+	}
+
+	state->index[slot] = offset + 1U;
+	state->index_count++;
+}
+
+/**
+ * spmc_shmem_index_rebuild - Rebuild the handle index from @state->data.
+ * @state:      Global state.
+ *
+ * Must be called whenever objects move in @state->data. Objects that have not
+ * received their first fragment do not have a handle yet and are skipped.
+ */
+static void spmc_shmem_index_rebuild(struct spmc_shmem_obj_state *state)
+{
+	uint8_t *curr = state->data;
+
+	(void)memset(state->index, 0, sizeof(state->index));
+	state->index_count = 0U;
+	state->index_full = false;
+
+	while (curr - state->data < state->allocated) {
+		struct spmc_shmem_obj *obj = (struct spmc_shmem_obj *)curr;
+
+		if (obj->desc_filled != 0U) {
+			spmc_shmem_index_add(state, obj);
+		}
+		curr += spmc_shmem_obj_size(obj->desc_size);
+	}
+}
+
+/**
+ * spmc_shmem_obj_ref_get - Keep the objects in place while @state is unlocked.
+ * @state:      Global state, must be locked.
+ *
+ * Lets the caller keep using a pointer returned by spmc_shmem_obj_lookup()
+ * after unlocking @state, until it calls spmc_shmem_obj_ref_put(). The object
+ * must not be modified in that time.
+ */
+static void spmc_shmem_obj_ref_get(struct spmc_shmem_obj_state *state)
+{
+	spin_lock(&state->refs_lock);
+	state->refs++;
+	spin_unlock(&state->refs_lock);
+}
+
+/**
+ * spmc_shmem_obj_ref_put - Drop a reference from spmc_shmem_obj_ref_get().
+ * @state:      Global state, does not need to be locked.
+ */
+static void spmc_shmem_obj_ref_put(struct spmc_shmem_obj_state *state)
+{
+	spin_lock(&state->refs_lock);
+	assert(state->refs != 0U);
+	state->refs--;
+	spin_unlock(&state->refs_lock);
+}
+
+/**
+ * spmc_shmem_obj_wait_refs - Wait until no object is referenced.
+ * @state:      Global state, must be locked.
+ *
+ * No new reference can be taken while @state is locked, and references are
+ * dropped without locking @state, so this always completes.
+ */
+static void spmc_shmem_obj_wait_refs(struct spmc_shmem_obj_state *state)
+{
+	unsigned int refs;
+
+	do {
+		spin_lock(&state->refs_lock);
+		refs = state->refs;
+		spin_unlock(&state->refs_lock);
+	} while (refs != 0U);
+}
+
 /**
  * spmc_shmem_obj_alloc - Allocate struct spmc_shmem_obj.
  * @state:      Global state.
@@ -106,6 +244,9 @@ spmc_shmem_obj_alloc(struct spmc_shmem_obj_state *state, size_t desc_size)
 	obj->desc_size = desc_size;
 	obj->desc_filled = 0;
 	obj->in_use = 0;
+	obj->view_ffa_version = 0U;
+	obj->cons_checked = 0U;
+	obj->page_count = 0U;
 	state->allocated += obj_size;
 	return obj;
 }
@@ -120,7 +261,9 @@ spmc_shmem_obj_alloc(struct spmc_shmem_obj_state *state, size_t desc_size)
  * just @obj.
  *
  * The current implementation always compacts the remaining objects to simplify
- * the allocator and to avoid fragmentation.
+ * the allocator and to avoid fragmentation, then rebuilds the handle index.
+ * It waits for any reference taken with spmc_shmem_obj_ref_get() to be
+ * dropped first.
  */
 
 static void spmc_shmem_obj_free(struct spmc_shmem_obj_state *state,
@@ -131,29 +274,56 @@ static void spmc_shmem_obj_free(struct spmc_shmem_obj_state *state,
 	uint8_t *shift_src = shift_dest + free_size;
 	size_t shift_size = state->allocated - (shift_src - state->data);
 
+	/* Objects still used by other CPUs must not move or be reused. */
+	spmc_shmem_obj_wait_refs(state);
+
 	if (shift_size != 0U) {
 		memmove(shift_dest, shift_src, shift_size);
 	}
 	state->allocated -= free_size;
+	spmc_shmem_index_rebuild(state);
 }
 
 /**
- * spmc_shmem_obj_lookup - Lookup struct spmc_shmem_obj by handle.
- * @state:      Global state.
- * @handle:     Unique handle of object to return.
+ * spmc_shmem_obj_lookup_view - Lookup struct spmc_shmem_obj by handle and view.
+ * @state:             Global state.
+ * @handle:            Unique handle of object to return.
+ * @view_ffa_version:  0 for the object itself, or FF-A version of the cached
+ *                     view of it to return.
+ *
+ * Uses the handle index, unless it overflowed, in which case @state->data is
+ * walked.
  *
  * Return: struct spmc_shmem_obj_state object with handle matching @handle.
  *         %NULL, if not object in @state->data has a matching handle.
  */
 static struct spmc_shmem_obj *
-spmc_shmem_obj_lookup(struct spmc_shmem_obj_state *state, uint64_t handle)
+spmc_shmem_obj_lookup_view(struct spmc_shmem_obj_state *state, uint64_t handle,
+			   uint32_t view_ffa_version)
 {
 	uint8_t *curr = state->data;
 
+	if (!state->index_full) {
+		unsigned int slot = spmc_shmem_index_hash(handle);
+
+		while (state->index[slot] != 0U) {
+			struct spmc_shmem_obj *obj = (struct spmc_shmem_obj *)
+				(state->data + state->index[slot] - 1U);
+
+			if ((obj->desc.handle == handle) &&
+			    (obj->view_ffa_version == view_ffa_version)) {
+				return obj;
+			}
+			slot = (slot + 1U) & (SPMC_SHMEM_INDEX_SIZE - 1U);
+		}
+		return NULL;
+	}
+
 	while (curr - state->data < state->allocated) {
 		struct spmc_shmem_obj *obj = (struct spmc_shmem_obj *)curr;
 
-		if (obj->desc.handle == handle) {
+		if ((obj->desc.handle == handle) &&
+		    (obj->view_ffa_version == view_ffa_version)) {
 			return obj;
 		}
 		curr += spmc_shmem_obj_size(obj->desc_size);
@@ -161,6 +331,21 @@ spmc_shmem_obj_lookup(struct spmc_shmem_obj_state *state, uint64_t handle)
 	return NULL;
 }
 
+/**
+ * spmc_shmem_obj_lookup - Lookup struct spmc_shmem_obj by handle.
+ * @state:      Global state.
+ * @handle:     Unique handle of object to return.
+ *
+ * Return: struct spmc_shmem_obj_state object with handle matching @handle,
+ *         excluding cached views of it.
+ *         %NULL, if not object in @state->data has a matching handle.
+ */
+static struct spmc_shmem_obj *
+spmc_shmem_obj_lookup(struct spmc_shmem_obj_state *state, uint64_t handle)
+{
+	return spmc_shmem_obj_lookup_view(state, handle, 0U);
+}
+
 /**
  * spmc_shmem_obj_get_next - Get the next memory object from an offset.
  * @offset:     Offset used to track which objects have previously been
@@ -185,6 +370,55 @@ spmc_shmem_obj_get_next(struct spmc_shmem_obj_state *state, size_t *offset)
 	return NULL;
 }
 
+/**
+ * spmc_shmem_obj_free_views - Free the cached views of an object.
+ * @state:      Global state.
+ * @handle:     Handle of the object.
+ *
+ * Like spmc_shmem_obj_free(), this invalidates all pointers to struct
+ * spmc_shmem_obj objects if a view is freed.
+ */
+static void spmc_shmem_obj_free_views(struct spmc_shmem_obj_state *state,
+				      uint64_t handle)
+{
+	struct spmc_shmem_obj *view;
+
+	view = spmc_shmem_obj_lookup_view(state, handle, MAKE_FFA_VERSION(1, 0));
+	if (view != NULL) {
+		spmc_shmem_obj_free(state, view);
+	}
+}
+
+/**
+ * spmc_shmem_obj_drop_views - Free all the cached views.
+ * @state:      Global state.
+ *
+ * Views are only a cache, they are dropped when the space they use is needed
+ * for a new object. Invalidates all pointers to struct spmc_shmem_obj objects.
+ *
+ * Return: true if any view was freed.
+ */
+static bool spmc_shmem_obj_drop_views(struct spmc_shmem_obj_state *state)
+{
+	size_t offset = 0;
+	bool dropped = false;
+
+	while (offset < state->allocated) {
+		struct spmc_shmem_obj *obj = (struct spmc_shmem_obj *)
+					     (state->data + offset);
+
+		if (obj->view_ffa_version != 0U) {
+			/* The next object is moved to @offset. */
+			spmc_shmem_obj_free(state, obj);
+			dropped = true;
+		} else {
+			offset += spmc_shmem_obj_size(obj->desc_size);
+		}
+	}
+
+	return dropped;
+}
+
 /*******************************************************************************
  * FF-A memory descriptor helper functions.
  ******************************************************************************/
@@ -620,63 +854,65 @@ spmc_shm_convert_mtd_to_v1_0(struct spmc_shmem_obj *out_obj,
 }
 
 /**
- * spmc_populate_ffa_v1_0_descriptor - Converts a given v1.1 memory object to
- *                                     the v1.0 format and populates the
- *                                     provided buffer.
- * @dst:	    Buffer to populate v1.0 ffa_memory_region_descriptor.
- * @orig_obj:	    Object containing v1.1 ffa_memory_region_descriptor.
- * @buf_size:	    Size of the buffer to populate.
- * @offset:	    The offset of the converted descriptor to copy.
- * @copy_size:	    Will be populated with the number of bytes copied.
- * @out_desc_size:  Will be populated with the total size of the v1.0
- *                  descriptor.
+ * spmc_shmem_obj_get_view - Get a view of an object in the format of an older
+ *                           FF-A version.
+ * @state:        Global state, must be locked.
+ * @obj:          Object containing v1.1 ffa_memory_region_descriptor.
+ * @ffa_version:  FF-A version of the view, only v1.0 is supported.
+ * @view:         Will be populated with the object holding the view.
+ *
+ * The view is converted the first time it is requested, then kept in
+ * @state->data until @obj is reclaimed or the space is needed for a new
+ * object, so retrieving a descriptor again or in several fragments does not
+ * convert it again. Views are only allocated, so @obj stays valid.
  *
- * Return: 0 if conversion and population succeeded.
- * Note: This function invalidates the reference to @orig therefore
- * `spmc_shmem_obj_lookup` must be called if further usage is required.
+ * Return: 0 on success, error code on failure.
  */
-static uint32_t
-spmc_populate_ffa_v1_0_descriptor(void *dst, struct spmc_shmem_obj *orig_obj,
-				 size_t buf_size, size_t offset,
-				 size_t *copy_size, size_t *v1_0_desc_size)
+static int spmc_shmem_obj_get_view(struct spmc_shmem_obj_state *state,
+				   struct spmc_shmem_obj *obj,
+				   uint32_t ffa_version,
+				   struct spmc_shmem_obj **view)
 {
-		struct spmc_shmem_obj *v1_0_obj;
+	struct spmc_shmem_obj *v1_0_obj;
+	size_t v1_0_desc_size;
 
-		/* Calculate the size that the v1.0 descriptor will require. */
-		*v1_0_desc_size = spmc_shm_get_v1_0_descriptor_size(
-					&orig_obj->desc, orig_obj->desc_size);
+	assert(ffa_version == MAKE_FFA_VERSION(1, 0));
+	assert(obj->view_ffa_version == 0U);
 
-		if (*v1_0_desc_size == 0) {
-			ERROR("%s: cannot determine size of descriptor.\n",
-			      __func__);
-			return FFA_ERROR_INVALID_PARAMETER;
-		}
-
-		/* Get a new obj to store the v1.0 descriptor. */
-		v1_0_obj = spmc_shmem_obj_alloc(&spmc_shmem_obj_state,
-						*v1_0_desc_size);
+	v1_0_obj = spmc_shmem_obj_lookup_view(state, obj->desc.handle,
+					      ffa_version);
+	if (v1_0_obj != NULL) {
+		*view = v1_0_obj;
+		return 0;
+	}
 
-		if (!v1_0_obj) {
-			return FFA_ERROR_NO_MEMORY;
-		}
+	/* Calculate the size that the v1.0 descriptor will require. */
+	v1_0_desc_size = spmc_shm_get_v1_0_descriptor_size(&obj->desc,
+							   obj->desc_size);
+	if (v1_0_desc_size == 0U) {
+		ERROR("%s: cannot determine size of descriptor.\n", __func__);
+		return FFA_ERROR_INVALID_PARAMETER;
+	}
 
-		/* Perform the conversion from v1.1 to v1.0. */
-		if (!spmc_shm_convert_mtd_to_v1_0(v1_0_obj, orig_obj)) {
-			spmc_shmem_obj_free(&spmc_shmem_obj_state, v1_0_obj);
-			return FFA_ERROR_INVALID_PARAMETER;
-		}
+	/* Get a new obj to store the v1.0 descriptor. */
+	v1_0_obj = spmc_shmem_obj_alloc(state, v1_0_desc_size);
+	if (v1_0_obj == NULL) {
+		return FFA_ERROR_NO_MEMORY;
+	}
 
-		*copy_size = MIN(v1_0_obj->desc_size - offset, buf_size);
-		memcpy(dst, (uint8_t *) &v1_0_obj->desc + offset, *copy_size);
+	/* Perform the conversion from v1.1 to v1.0. */
+	if (!spmc_shm_convert_mtd_to_v1_0(v1_0_obj, obj)) {
+		/* Nothing was allocated after the view, @obj does not move. */
+		spmc_shmem_obj_free(state, v1_0_obj);
+		return FFA_ERROR_INVALID_PARAMETER;
+	}
 
-		/*
-		 * We're finished with the v1.0 descriptor for now so free it.
-		 * Note that this will invalidate any references to the v1.1
-		 * descriptor.
-		 */
-		spmc_shmem_obj_free(&spmc_shmem_obj_state, v1_0_obj);
+	v1_0_obj->desc_filled = v1_0_desc_size;
+	v1_0_obj->view_ffa_version = ffa_version;
+	spmc_shmem_index_add(state, v1_0_obj);
 
-		return 0;
+	*view = v1_0_obj;
+	return 0;
 }
 
 static int
@@ -768,6 +1004,68 @@ emad_advance(const struct ffa_emad_v1_0 *emad, size_t offset)
 	return (const struct ffa_emad_v1_0 *)((const uint8_t *)emad + offset);
 }
 
+/**
+ * spmc_shmem_check_new_cons - Validate the constituents received so far.
+ * @obj:	  Object being filled with ffa_memory_region_descriptor.
+ * @ffa_version:  FF-A version of the provided descriptor.
+ *
+ * Called after each fragment, so that each constituent memory region
+ * descriptor is only looked at once however many fragments the descriptor is
+ * sent in. Nothing is checked until the first endpoint descriptor and the
+ * composite memory region descriptor it points to have been received. The
+ * layout is only fully checked in spmc_shmem_check_obj(), which then uses the
+ * counts kept in @obj.
+ */
+static void spmc_shmem_check_new_cons(struct spmc_shmem_obj *obj,
+				      uint32_t ffa_version)
+{
+	const struct ffa_emad_v1_0 *first_emad;
+	const struct ffa_comp_mrd *comp;
+	size_t emad_size;
+	size_t comp_mrd_offset;
+	size_t count;
+
+	first_emad = spmc_shmem_obj_get_emad(&obj->desc, 0,
+					     ffa_version, &emad_size);
+	if (((const uint8_t *)first_emad + sizeof(*first_emad)) >
+	    ((const uint8_t *)&obj->desc + obj->desc_filled)) {
+		return;
+	}
+
+	comp_mrd_offset = first_emad->comp_mrd_offset;
+	if (!is_aligned(comp_mrd_offset, 16) ||
+	    (comp_mrd_offset > obj->desc_filled) ||
+	    ((obj->desc_filled - comp_mrd_offset) < sizeof(*comp))) {
+		return;
+	}
+
+	comp = (const struct ffa_comp_mrd *)
+	       ((const uint8_t *)(&obj->desc) + comp_mrd_offset);
+
+	count = (obj->desc_filled - comp_mrd_offset - sizeof(*comp)) /
+		sizeof(struct ffa_cons_mrd);
+	count = MIN(count, (size_t)comp->address_range_count);
+
+	for (size_t i = obj->cons_checked; i < count; i++) {
+		const struct ffa_cons_mrd *mrd = comp->address_range_array + i;
+
+		if (!is_aligned(mrd->address, PAGE_SIZE)) {
+			WARN("%s: invalid object, address in region descriptor "
+			     "%zu not 4K aligned (got 0x%016llx)",
+			     __func__, i, (unsigned long long)mrd->address);
+		}
+
+		/*
+		 * No overflow possible: page_count can hold at least
+		 * 2^64 - 1, but will be have at most 2^32 - 1 values added to
+		 * it, each of which cannot exceed 2^32 - 1.
+		 */
+		obj->page_count += mrd->page_count;
+	}
+
+	obj->cons_checked = (uint32_t)count;
+}
+
 /**
  * spmc_shmem_check_obj - Check that counts in descriptor match overall size.
  * @obj:	  Object containing ffa_memory_region_descriptor.
@@ -779,7 +1077,6 @@ emad_advance(const struct ffa_emad_v1_0 *emad, size_t offset)
 static int spmc_shmem_check_obj(struct spmc_shmem_obj *obj,
 				uint32_t ffa_version)
 {
-	unsigned long long total_page_count;
 	const struct ffa_emad_v1_0 *first_emad;
 	const struct ffa_emad_v1_0 *end_emad;
 	size_t emad_size;
@@ -915,32 +1212,16 @@ static int spmc_shmem_check_obj(struct spmc_shmem_obj *obj,
 		return FFA_ERROR_INVALID_PARAMETER;
 	}
 
-	total_page_count = 0;
-
 	/*
-	 * comp->address_range_count is 32-bit, so 'count' must fit in a
-	 * uint32_t at this point.
+	 * The constituents were validated as the fragments were received. The
+	 * layout checked above is the one spmc_shmem_check_new_cons() used on
+	 * the last fragment, so all of them have been counted.
 	 */
-	for (size_t i = 0; i < count; i++) {
-		const struct ffa_cons_mrd *mrd = comp->address_range_array + i;
-
-		if (!is_aligned(mrd->address, PAGE_SIZE)) {
-			WARN("%s: invalid object, address in region descriptor "
-			     "%zu not 4K aligned (got 0x%016llx)",
-			     __func__, i, (unsigned long long)mrd->address);
-		}
-
-		/*
-		 * No overflow possible: total_page_count can hold at
-		 * least 2^64 - 1, but will be have at most 2^32 - 1.
-		 * values added to it, each of which cannot exceed 2^32 - 1.
-		 */
-		total_page_count += mrd->page_count;
-	}
+	assert(obj->cons_checked == count);
 
-	if (comp->total_page_count != total_page_count) {
-		WARN("%s: invalid object, desc total_page_count %u != %llu\n",
-		     __func__, comp->total_page_count, total_page_count);
+	if (comp->total_page_count != obj->page_count) {
+		WARN("%s: invalid object, desc total_page_count %u != %" PRIu64 "\n",
+		     __func__, comp->total_page_count, obj->page_count);
 		return FFA_ERROR_INVALID_PARAMETER;
 	}
 
@@ -976,11 +1257,13 @@ static int spmc_shmem_check_state_obj(struct spmc_shmem_obj *obj,
 
 	while (inflight_obj != NULL) {
 		/*
-		 * Don't compare the transaction to itself or to partially
-		 * transmitted descriptors.
+		 * Don't compare the transaction to itself, to partially
+		 * transmitted descriptors or to cached views, which are in
+		 * another format.
 		 */
 		if ((obj->desc.handle != inflight_obj->desc.handle) &&
-		    (obj->desc_size == obj->desc_filled)) {
+		    (obj->desc_size == obj->desc_filled) &&
+		    (inflight_obj->view_ffa_version == 0U)) {
 			other_mrd = spmc_shmem_obj_get_comp_mrd(inflight_obj,
 							  FFA_VERSION_COMPILED);
 			if (other_mrd == NULL) {
@@ -1070,9 +1353,11 @@ static long spmc_ffa_fill_desc(struct mailbox *mbox,
 
 		obj->desc.handle = spmc_shmem_obj_state.next_handle++;
 		obj->desc.flags |= mtd_flag;
+		spmc_shmem_index_add(&spmc_shmem_obj_state, obj);
 	}
 
 	obj->desc_filled += fragment_length;
+	spmc_shmem_check_new_cons(obj, ffa_version);
 
 	handle_low = (uint32_t)obj->desc.handle;
 	handle_high = obj->desc.handle >> 32;
@@ -1115,8 +1400,18 @@ static long spmc_ffa_fill_desc(struct mailbox *mbox,
 		}
 
 		/* Get a new obj to store the v1.1 descriptor. */
+		mem_handle = obj->desc.handle;
 		v1_1_obj =
 		    spmc_shmem_obj_alloc(&spmc_shmem_obj_state, (size_t)v1_1_desc_size);
+		if ((v1_1_obj == NULL) &&
+		    spmc_shmem_obj_drop_views(&spmc_shmem_obj_state)) {
+			/* Dropping the views may have moved @obj. */
+			obj = spmc_shmem_obj_lookup(&spmc_shmem_obj_state,
+						    mem_handle);
+			assert(obj != NULL);
+			v1_1_obj = spmc_shmem_obj_alloc(&spmc_shmem_obj_state,
+							(size_t)v1_1_desc_size);
+		}
 
 		if (!v1_1_obj) {
 			ret = FFA_ERROR_NO_MEMORY;
@@ -1136,7 +1431,6 @@ static long spmc_ffa_fill_desc(struct mailbox *mbox,
 		 * We're finished with the v1.0 descriptor so free it
 		 * and continue our checks with the new v1.1 descriptor.
 		 */
-		mem_handle = obj->desc.handle;
 		spmc_shmem_obj_free(&spmc_shmem_obj_state, obj);
 		obj = spmc_shmem_obj_lookup(&spmc_shmem_obj_state, mem_handle);
 		if (obj == NULL) {
@@ -1240,6 +1534,9 @@ long spmc_ffa_mem_send(uint32_t smc_fid,
 
 	spin_lock(&spmc_shmem_obj_state.lock);
 	obj = spmc_shmem_obj_alloc(&spmc_shmem_obj_state, total_length);
+	if ((obj == NULL) && spmc_shmem_obj_drop_views(&spmc_shmem_obj_state)) {
+		obj = spmc_shmem_obj_alloc(&spmc_shmem_obj_state, total_length);
+	}
 	if (obj == NULL) {
 		ret = FFA_ERROR_NO_MEMORY;
 		goto err_unlock;
@@ -1399,6 +1696,7 @@ spmc_ffa_mem_retrieve_req(uint32_t smc_fid,
 	struct ffa_mtd *resp;
 	const struct ffa_mtd *req;
 	struct spmc_shmem_obj *obj = NULL;
+	struct spmc_shmem_obj *src_obj;
 	struct mailbox *mbox = spmc_get_mbox_desc(secure_origin);
 	uint32_t ffa_version = get_partition_ffa_version(secure_origin);
 	struct secure_partition_desc *sp_ctx = spmc_get_current_sp_ctx();
@@ -1588,35 +1886,39 @@ spmc_ffa_mem_retrieve_req(uint32_t smc_fid,
 		}
 	}
 
+	/* If the caller is v1.0, use the descriptor converted to v1.0. */
+	src_obj = obj;
+	if (ffa_version == MAKE_FFA_VERSION(1, 0)) {
+		ret = spmc_shmem_obj_get_view(&spmc_shmem_obj_state, obj,
+					      ffa_version, &src_obj);
+		if (ret != 0) {
+			ERROR("%s: Failed to process descriptor.\n", __func__);
+			goto err_unlock_all;
+		}
+	}
+
 	mbox->state = MAILBOX_STATE_FULL;
 
 	if (req->emad_count != 0U) {
 		obj->in_use++;
 	}
 
+	copy_size = MIN(src_obj->desc_size, buf_size);
+	out_desc_size = src_obj->desc_size;
+
 	/*
-	 * If the caller is v1.0 convert the descriptor, otherwise copy
-	 * directly.
+	 * The copy is done without holding the global lock so that other
+	 * objects can be retrieved in the meantime.
 	 */
-	if (ffa_version == MAKE_FFA_VERSION(1, 0)) {
-		ret = spmc_populate_ffa_v1_0_descriptor(resp, obj, buf_size, 0,
-							&copy_size,
-							&out_desc_size);
-		if (ret != 0U) {
-			ERROR("%s: Failed to process descriptor.\n", __func__);
-			goto err_unlock_all;
-		}
-	} else {
-		copy_size = MIN(obj->desc_size, buf_size);
-		out_desc_size = obj->desc_size;
+	spmc_shmem_obj_ref_get(&spmc_shmem_obj_state);
+	spin_unlock(&spmc_shmem_obj_state.lock);
 
-		memcpy(resp, &obj->desc, copy_size);
-	}
+	memcpy(resp, &src_obj->desc, copy_size);
+	spmc_shmem_obj_ref_put(&spmc_shmem_obj_state);
 
 	/* Set the NS bit in the response if applicable. */
 	spmc_ffa_mem_retrieve_set_ns_bit(resp, sp_ctx);
 
-	spin_unlock(&spmc_shmem_obj_state.lock);
 	spin_unlock(&mbox->lock);
 
 	SMC_RET8(handle, FFA_MEM_RETRIEVE_RESP, out_desc_size,
@@ -1661,6 +1963,7 @@ long spmc_ffa_mem_frag_rx(uint32_t smc_fid,
 	struct mailbox *mbox = spmc_get_mbox_desc(secure_origin);
 	uint64_t mem_handle = handle_low | (((uint64_t)handle_high) << 32);
 	struct spmc_shmem_obj *obj;
+	struct spmc_shmem_obj *src_obj;
 	uint32_t ffa_version = get_partition_ffa_version(secure_origin);
 
 	if (!secure_origin) {
@@ -1688,9 +1991,20 @@ long spmc_ffa_mem_frag_rx(uint32_t smc_fid,
 		goto err_unlock_shmem;
 	}
 
-	if (fragment_offset >= obj->desc_size) {
+	/* If the caller is v1.0, use the descriptor converted to v1.0. */
+	src_obj = obj;
+	if (ffa_version == MAKE_FFA_VERSION(1, 0)) {
+		ret = spmc_shmem_obj_get_view(&spmc_shmem_obj_state, obj,
+					      ffa_version, &src_obj);
+		if (ret != 0) {
+			ERROR("%s: Failed to process descriptor.\n", __func__);
+			goto err_unlock_shmem;
+		}
+	}
+
+	if (fragment_offset >= src_obj->desc_size) {
 		WARN("%s: invalid fragment_offset 0x%x >= 0x%zx\n",
-		     __func__, fragment_offset, obj->desc_size);
+		     __func__, fragment_offset, src_obj->desc_size);
 		ret = FFA_ERROR_INVALID_PARAMETER;
 		goto err_unlock_shmem;
 	}
@@ -1713,33 +2027,19 @@ long spmc_ffa_mem_frag_rx(uint32_t smc_fid,
 
 	mbox->state = MAILBOX_STATE_FULL;
 
-	/*
-	 * If the caller is v1.0 convert the descriptor, otherwise copy
-	 * directly.
-	 */
-	if (ffa_version == MAKE_FFA_VERSION(1, 0)) {
-		size_t out_desc_size;
-
-		ret = spmc_populate_ffa_v1_0_descriptor(mbox->rx_buffer, obj,
-							buf_size,
-							fragment_offset,
-							&copy_size,
-							&out_desc_size);
-		if (ret != 0U) {
-			ERROR("%s: Failed to process descriptor.\n", __func__);
-			goto err_unlock_all;
-		}
-	} else {
-		full_copy_size = obj->desc_size - fragment_offset;
-		copy_size = MIN(full_copy_size, buf_size);
+	full_copy_size = src_obj->desc_size - fragment_offset;
+	copy_size = MIN(full_copy_size, buf_size);
 
-		src = &obj->desc;
+	src = &src_obj->desc;
 
-		memcpy(mbox->rx_buffer, src + fragment_offset, copy_size);
-	}
+	/* Copy without holding the global lock. */
+	spmc_shmem_obj_ref_get(&spmc_shmem_obj_state);
+	spin_unlock(&spmc_shmem_obj_state.lock);
+
+	memcpy(mbox->rx_buffer, src + fragment_offset, copy_size);
+	spmc_shmem_obj_ref_put(&spmc_shmem_obj_state);
 
 	spin_unlock(&mbox->lock);
-	spin_unlock(&spmc_shmem_obj_state.lock);
 
 	SMC_RET8(handle, FFA_MEM_FRAG_TX, handle_low, handle_high,
 		 copy_size, sender_id, 0, 0, 0);
@@ -1924,6 +2224,7 @@ int spmc_ffa_mem_reclaim(uint32_t smc_fid,
 	}
 
 	spmc_shmem_obj_free(&spmc_shmem_obj_state, obj);
+	spmc_shmem_obj_free_views(&spmc_shmem_obj_state, mem_handle);
 	spin_unlock(&spmc_shmem_obj_state.lock);
 
 	SMC_RET1(handle, FFA_SUCCESS_SMC32);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2022-2024, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -31,20 +31,39 @@ struct ffa_mem_relinquish_descriptor {
 CASSERT(sizeof(struct ffa_mem_relinquish_descriptor) == 16,
 	assert_ffa_mem_relinquish_descriptor_size_mismatch);
 
+/* Number of slots of the handle index, must be a power of two. */
+#ifndef SPMC_SHMEM_INDEX_SIZE
+#define SPMC_SHMEM_INDEX_SIZE	U(256)
+#endif
+
 /**
  * struct spmc_shmem_obj_state - Global state.
  * @data:           Backing store for spmc_shmem_obj objects.
  * @data_size:      The size allocated for the backing store.
  * @allocated:      Number of bytes allocated in @data.
  * @next_handle:    Handle used for next allocated object.
- * @lock:           Lock protecting all state in this file.
+ * @index:          Open-addressed table of the offsets in @data of the
+ *                  objects, plus one, hashed by handle. 0 marks a free slot.
+ * @index_count:    Number of objects in @index.
+ * @index_full:     Set when @index could not hold every object, lookups then
+ *                  walk @data instead.
+ * @lock:           Lock protecting all state in this file, except @refs.
+ * @refs:           Number of references to objects in @data that are used
+ *                  without holding @lock. Objects are not moved while it is
+ *                  not 0.
+ * @refs_lock:      Lock protecting @refs.
  */
 struct spmc_shmem_obj_state {
 	uint8_t *data;
 	size_t data_size;
 	size_t allocated;
 	uint64_t next_handle;
+	size_t index[SPMC_SHMEM_INDEX_SIZE];
+	unsigned int index_count;
+	bool index_full;
 	spinlock_t lock;
+	unsigned int refs;
+	spinlock_t refs_lock;
 };
 
 extern struct spmc_shmem_obj_state spmc_shmem_obj_state;
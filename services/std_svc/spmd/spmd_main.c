@@ -403,21 +403,20 @@ static void spmd_do_sec_cpy(uintptr_t root_base_addr, uintptr_t sec_base_addr,
 	/* Do copy operation */
 	(void)memcpy((void *)sec_base_addr, (void *)root_base_addr, size);
 
-	/* Unmap root memory region */
-	rc = mmap_remove_dynamic_region(root_base_addr_align,
-					root_mapped_size_align);
+	/* Unmap root and secure memory regions together */
+	mmap_region_t unmap_regions[] = {
+		{ .base_va = root_base_addr_align,
+		  .size = root_mapped_size_align },
+		{ .base_va = sec_base_addr_align,
+		  .size = sec_mapped_size_align },
+	};
+
+	rc = mmap_remove_dynamic_regions(unmap_regions,
+					 ARRAY_SIZE(unmap_regions));
 	if (rc != 0) {
-		ERROR("%s %s %lu (%d)\n", "Error while unmapping",
-		      "root region", root_base_addr_align, rc);
-		panic();
-	}
-
-	/* Unmap secure memory region */
-	rc = mmap_remove_dynamic_region(sec_base_addr_align,
-					sec_mapped_size_align);
-	if (rc != 0) {
-		ERROR("%s %s %lu (%d)\n", "Error while unmapping",
-		      "secure region", sec_base_addr_align, rc);
+		ERROR("%s %s %lu/%lu (%d)\n", "Error while unmapping",
+		      "root/secure regions", root_base_addr_align,
+		      sec_base_addr_align, rc);
 		panic();
 	}
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2014-2023, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2014-2024, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -234,13 +234,47 @@ static uintptr_t std_svc_smc_handler(uint32_t smc_fid,
 	}
 }
 
+#if ENABLE_SMC_LEAF_HANDLERS
+/*
+ * Leaf handler for the Standard Service Calls that only return information,
+ * see rt_svc_desc_t. Returns 0 for the calls to pass to std_svc_smc_handler().
+ */
+static uintptr_t std_svc_leaf_handler(uint32_t smc_fid,
+			     u_register_t x1,
+			     u_register_t x2,
+			     u_register_t x3,
+			     u_register_t x4,
+			     void *cookie,
+			     void *handle,
+			     u_register_t flags)
+{
+	if ((smc_fid == PSCI_VERSION) || (smc_fid == PSCI_FEATURES)) {
+		SMC_RET1(handle, psci_smc_handler(smc_fid, (uint32_t)x1,
+						  (uint32_t)x2, (uint32_t)x3,
+						  (uint32_t)x4, cookie, handle,
+						  flags));
+	}
+
+#if TRNG_SUPPORT
+	if ((smc_fid == ARM_TRNG_VERSION) || (smc_fid == ARM_TRNG_FEATURES)) {
+		return trng_smc_handler(smc_fid, (uint32_t)x1, (uint32_t)x2,
+					(uint32_t)x3, (uint32_t)x4, cookie,
+					handle, flags);
+	}
+#endif /* TRNG_SUPPORT */
+
+	return 0;
+}
+#endif /* ENABLE_SMC_LEAF_HANDLERS */
+
 /* Register Standard Service Calls as runtime service */
-DECLARE_RT_SVC(
+DECLARE_RT_SVC_LEAF(
 		std_svc,
 
 		OEN_STD_START,
 		OEN_STD_END,
 		SMC_TYPE_FAST,
 		std_svc_setup,
-		std_svc_smc_handler
+		std_svc_smc_handler,
+		std_svc_leaf_handler
 );
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2022, ARM Limited. All rights reserved.
+ * Copyright (c) 2021-2024, ARM Limited. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -7,230 +7,159 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <lib/cassert.h>
 #include <lib/spinlock.h>
+#include <lib/utils_def.h>
 #include <plat/common/plat_trng.h>
+#include <plat/common/platform.h>
+
+#include <platform_def.h>
 
 /*
- * # Entropy pool
- * Note that the TRNG Firmware interface can request up to 192 bits of entropy
- * in a single call or three 64bit words per call. We have 4 words in the pool
- * so that when we have 1-63 bits in the pool, and we have a request for
- * 192 bits of entropy, we don't have to throw out the leftover 1-63 bits of
- * entropy.
+ * # Entropy reservoirs
+ * Each CPU serves TRNG calls from its own reservoir of entropy, so that calls
+ * made in parallel on different CPUs do not serialize. A reservoir holds up to
+ * TRNG_RESERVOIR_WORDS full words from the entropy source, plus the leftover
+ * bits of the last word that was partly used. When a call needs more bits
+ * than the reservoir holds, it is refilled with as many words as it can take.
+ *
+ * The TRNG Firmware interface can request up to 192 bits of entropy in a
+ * single call, so a reservoir must be able to hold three words on top of the
+ * leftover bits.
  */
-#define WORDS_IN_POOL	(4)
-static uint64_t entropy[WORDS_IN_POOL];
-/* index in bits of the first bit of usable entropy */
-static uint32_t entropy_bit_index;
-/* then number of valid bits in the entropy pool */
-static uint32_t entropy_bit_size;
+#ifndef TRNG_RESERVOIR_WORDS
+#define TRNG_RESERVOIR_WORDS	U(8)
+#endif
+
+CASSERT(TRNG_RESERVOIR_WORDS >= U(3), assert_trng_reservoir_words);
+
+#define BITS_PER_WORD		U(64)
+
+typedef struct trng_reservoir {
+	/* Full words of entropy, used from the end */
+	uint64_t words[TRNG_RESERVOIR_WORDS];
+	unsigned int nwords;
+	/* Unused bits of a partly used word, in its lower bits */
+	uint64_t partial;
+	unsigned int partial_bits;
+} __aligned(CACHE_WRITEBACK_GRANULE) trng_reservoir_t;
+
+static trng_reservoir_t trng_reservoirs[PLATFORM_CORE_COUNT];
 
+/*
+ * The entropy source is only accessed with this lock held, as platforms are
+ * not required to support calls to plat_get_entropy() from several CPUs at a
+ * time. It is only taken to refill a reservoir.
+ */
 static spinlock_t trng_pool_lock;
 
-#define BITS_PER_WORD		(sizeof(entropy[0]) * 8)
-#define BITS_IN_POOL		(WORDS_IN_POOL * BITS_PER_WORD)
-#define ENTROPY_MIN_WORD	(entropy_bit_index / BITS_PER_WORD)
-#define ENTROPY_FREE_BIT	(entropy_bit_size + entropy_bit_index)
-#define _ENTROPY_FREE_WORD	(ENTROPY_FREE_BIT / BITS_PER_WORD)
-#define ENTROPY_FREE_INDEX	(_ENTROPY_FREE_WORD % WORDS_IN_POOL)
-/* ENTROPY_WORD_INDEX(0) includes leftover bits in the lower bits */
-#define ENTROPY_WORD_INDEX(i)	((ENTROPY_MIN_WORD + i) % WORDS_IN_POOL)
+static unsigned int trng_reservoir_bits(const trng_reservoir_t *res)
+{
+	return (res->nwords * BITS_PER_WORD) + res->partial_bits;
+}
 
 /*
- * Fill the entropy pool until we have at least as many bits as requested.
- * Returns true after filling the pool, and false if the entropy source is out
- * of entropy and the pool could not be filled.
- * Assumes locks are taken.
+ * Fill the reservoir until it is full. Returns true if it then holds at least
+ * as many bits as requested, and false if the entropy source is out of
+ * entropy before that.
  */
-static bool trng_fill_entropy(uint32_t nbits)
+static bool trng_fill_reservoir(trng_reservoir_t *res, uint32_t nbits)
 {
-	while (nbits > entropy_bit_size) {
-		bool valid = plat_get_entropy(&entropy[ENTROPY_FREE_INDEX]);
-
-		if (valid) {
-			entropy_bit_size += BITS_PER_WORD;
-			assert(entropy_bit_size <= BITS_IN_POOL);
-		} else {
-			return false;
+	spin_lock(&trng_pool_lock);
+
+	while (res->nwords < TRNG_RESERVOIR_WORDS) {
+		if (!plat_get_entropy(&res->words[res->nwords])) {
+			break;
 		}
+		res->nwords++;
 	}
-	return true;
+
+	spin_unlock(&trng_pool_lock);
+
+	return trng_reservoir_bits(res) >= nbits;
 }
 
 /*
- * Pack entropy into the out buffer, filling and taking locks as needed.
- * Returns true on success, false on failure.
- *
- * Note: out must have enough space for nbits of entropy
+ * Take 'nbits' bits, 1 to 64, from the reservoir. The leftover bits are used
+ * first, then the lower bits of the next word, whose upper bits are kept as
+ * the new leftover bits.
  */
-bool trng_pack_entropy(uint32_t nbits, uint64_t *out)
+static uint64_t trng_take_bits(trng_reservoir_t *res, unsigned int nbits)
 {
-	bool ret = true;
-	uint32_t bits_to_discard = nbits;
-	spin_lock(&trng_pool_lock);
+	uint64_t bits = res->partial;
+	uint64_t word;
+	unsigned int needed;
 
-	if (!trng_fill_entropy(nbits)) {
-		ret = false;
-		goto out;
-	}
+	assert((nbits != 0U) && (nbits <= BITS_PER_WORD));
 
-	const unsigned int rshift = entropy_bit_index % BITS_PER_WORD;
-	const unsigned int lshift = BITS_PER_WORD - rshift;
-	const int to_fill = ((nbits + BITS_PER_WORD - 1) / BITS_PER_WORD);
-	int word_i;
-
-	for (word_i = 0; word_i < to_fill; word_i++) {
-		/*
-		 * Repack the entropy from the pool into the passed in out
-		 * buffer. This takes lesser bits from the valid upper bits
-		 * of word_i and more bits from the lower bits of (word_i + 1).
-		 *
-		 * I found the following diagram useful. note: `e` represents
-		 * valid entropy, ` ` represents invalid bits (not entropy) and
-		 * `x` represents valid entropy that must not end up in the
-		 * packed word.
-		 *
-		 *          |---------entropy pool----------|
-		 * C var    |--(word_i + 1)-|----word_i-----|
-		 * bit idx  |7 6 5 4 3 2 1 0|7 6 5 4 3 2 1 0|
-		 *          [x,x,e,e,e,e,e,e|e,e, , , , , , ]
-		 *          |   [e,e,e,e,e,e,e,e]           |
-		 *          |   |--out[word_i]--|           |
-		 *    lshift|---|               |--rshift---|
-		 *
-		 *          ==== Which is implemented as ====
-		 *
-		 *          |---------entropy pool----------|
-		 * C var    |--(word_i + 1)-|----word_i-----|
-		 * bit idx  |7 6 5 4 3 2 1 0|7 6 5 4 3 2 1 0|
-		 *          [x,x,e,e,e,e,e,e|e,e, , , , , , ]
-		 * C expr       << lshift       >> rshift
-		 * bit idx   5 4 3 2 1 0                 7 6
-		 *          [e,e,e,e,e,e,0,0|0,0,0,0,0,0,e,e]
-		 *                ==== bit-wise or ====
-		 *                   5 4 3 2 1 0 7 6
-		 *                  [e,e,e,e,e,e,e,e]
-		 */
-		out[word_i] |= entropy[ENTROPY_WORD_INDEX(word_i)] >> rshift;
-
-		/**
-		 * Discarding the used/packed entropy bits from the respective
-		 * words, (word_i) and (word_i+1) as applicable.
-		 * In each iteration of the loop, we pack 64bits of entropy to
-		 * the output buffer. The bits are picked linearly starting from
-		 * 1st word (entropy[0]) till 4th word (entropy[3]) and then
-		 * rolls back (entropy[0]). Discarding of bits is managed
-		 * similarly.
-		 *
-		 * The following diagram illustrates the logic:
-		 *
-		 *          |---------entropy pool----------|
-		 * C var    |--(word_i + 1)-|----word_i-----|
-		 * bit idx  |7 6 5 4 3 2 1 0|7 6 5 4 3 2 1 0|
-		 *          [e,e,e,e,e,e,e,e|e,e,0,0,0,0,0,0]
-		 *          |   [e,e,e,e,e,e,e,e]           |
-		 *          |   |--out[word_i]--|           |
-		 *    lshift|---|               |--rshift---|
-		 *          |e,e|0,0,0,0,0,0,0,0|0,0,0,0,0,0|
-		 *              |<==   ||    ==>|
-		 *               bits_to_discard (from these bytes)
-		 *
-		 * variable(bits_to_discard): Tracks the amount of bits to be
-		 * discarded and is updated accordingly in each iteration.
-		 *
-		 * It monitors these packed bits from respective word_i and
-		 * word_i+1 and overwrites them with zeros accordingly.
-		 * It discards linearly from the lowest index and moves upwards
-		 * until bits_to_discard variable becomes zero.
-		 *
-		 * In the above diagram,for example, we pack 2bytes(7th and 6th
-		 * from word_i) and 6bytes(0th till 5th from word_i+1), combine
-		 * and pack them as 64bit to output buffer out[i].
-		 * Depending on the number of bits requested, we discard the
-		 * bits from these packed bytes by overwriting them with zeros.
-		 */
-
-		/*
-		 * If the bits to be discarded is lesser than the amount of bits
-		 * copied to the output buffer from word_i, we discard that much
-		 * amount of bits only.
-		 */
-		if (bits_to_discard < (BITS_PER_WORD - rshift)) {
-			entropy[ENTROPY_WORD_INDEX(word_i)] &=
-			(~0ULL << ((bits_to_discard+rshift) % BITS_PER_WORD));
-			bits_to_discard = 0;
-		} else {
-		/*
-		 * If the bits to be discarded is more than the amount of valid
-		 * upper bits from word_i, which has been copied to the output
-		 * buffer, we just set the entire word_i to 0, as the lower bits
-		 * will be already zeros from previous operations, and the
-		 * bits_to_discard is updated precisely.
-		 */
-			entropy[ENTROPY_WORD_INDEX(word_i)] = 0;
-			bits_to_discard -= (BITS_PER_WORD - rshift);
-		}
+	/* There are never 64 leftover bits, so nbits is below 64 here */
+	if (res->partial_bits >= nbits) {
+		res->partial >>= nbits;
+		res->partial_bits -= nbits;
+		return bits & ((UINT64_C(1) << nbits) - 1U);
+	}
 
-		/*
-		 * Note that a shift of 64 bits is treated as a shift of 0 bits.
-		 * When the shift amount is the same as the BITS_PER_WORD, we
-		 * don't want to include the next word of entropy, so we skip
-		 * the `|=` operation.
-		 */
-		if (lshift != BITS_PER_WORD) {
-			out[word_i] |= entropy[ENTROPY_WORD_INDEX(word_i + 1)]
-				<< lshift;
-			/**
-			 * Discarding the remaining packed bits from upperword
-			 * (word[i+1]) which was copied to output buffer by
-			 * overwriting with zeros.
-			 *
-			 * If the remaining bits to be discarded is lesser than
-			 * the amount of bits from [word_i+1], which has been
-			 * copied to the output buffer, we overwrite that much
-			 * amount of bits only.
-			 */
-			if (bits_to_discard < (BITS_PER_WORD - lshift)) {
-				entropy[ENTROPY_WORD_INDEX(word_i+1)]  &=
-				(~0ULL << ((bits_to_discard) % BITS_PER_WORD));
-				bits_to_discard = 0;
-			} else {
-			/*
-			 * If bits to discard is more than the bits from word_i+1
-			 * which got packed into the output, then we discard all
-			 * those copied bits.
-			 *
-			 * Note: we cannot set the entire word_i+1 to 0, as
-			 * there are still some unused valid entropy bits at the
-			 * upper end for future use.
-			 */
-				entropy[ENTROPY_WORD_INDEX(word_i+1)]  &=
-				(~0ULL << ((BITS_PER_WORD - lshift) % BITS_PER_WORD));
-				bits_to_discard -= (BITS_PER_WORD - lshift);
-		}
+	assert(res->nwords != 0U);
+	res->nwords--;
+	word = res->words[res->nwords];
+	res->words[res->nwords] = 0U;
 
-		}
+	/* partial_bits is less than nbits, so both shifts are below 64 */
+	needed = nbits - res->partial_bits;
+	bits |= word << res->partial_bits;
+	if (nbits != BITS_PER_WORD) {
+		bits &= (UINT64_C(1) << nbits) - 1U;
 	}
-	const uint64_t mask = ~0ULL >> (BITS_PER_WORD - (nbits % BITS_PER_WORD));
 
-	out[to_fill - 1] &= mask;
+	res->partial = (needed == BITS_PER_WORD) ? 0U : (word >> needed);
+	res->partial_bits = BITS_PER_WORD - needed;
 
-	entropy_bit_index = (entropy_bit_index + nbits) % BITS_IN_POOL;
-	entropy_bit_size -= nbits;
+	return bits;
+}
 
-out:
-	spin_unlock(&trng_pool_lock);
+/*
+ * Pack entropy into the out buffer, refilling the reservoir of the calling CPU
+ * as needed. Returns true on success, false on failure. No lock is taken when
+ * the reservoir holds enough entropy.
+ *
+ * Note: out must have enough space for nbits of entropy
+ */
+bool trng_pack_entropy(uint32_t nbits, uint64_t *out)
+{
+	trng_reservoir_t *res = &trng_reservoirs[plat_my_core_pos()];
+	unsigned int word_i = 0U;
+
+	assert(nbits <= (TRNG_RESERVOIR_WORDS * BITS_PER_WORD));
+
+	if ((trng_reservoir_bits(res) < nbits) &&
+	    !trng_fill_reservoir(res, nbits)) {
+		return false;
+	}
+
+	while (nbits != 0U) {
+		unsigned int chunk = (nbits < BITS_PER_WORD) ? nbits :
+			BITS_PER_WORD;
 
-	return ret;
+		out[word_i] = trng_take_bits(res, chunk);
+		nbits -= chunk;
+		word_i++;
+	}
+
+	return true;
 }
 
 void trng_entropy_pool_setup(void)
 {
-	int i;
+	unsigned int cpu, i;
 
-	for (i = 0; i < WORDS_IN_POOL; i++) {
-		entropy[i] = 0;
+	for (cpu = 0U; cpu < PLATFORM_CORE_COUNT; cpu++) {
+		trng_reservoir_t *res = &trng_reservoirs[cpu];
+
+		for (i = 0U; i < TRNG_RESERVOIR_WORDS; i++) {
+			res->words[i] = 0U;
+		}
+		res->nwords = 0U;
+		res->partial = 0U;
+		res->partial_bits = 0U;
 	}
-	entropy_bit_index = 0;
-	entropy_bit_size = 0;
 }